@@ -6,6 +6,7 @@
 #define MY_RF24_IRQ_PIN (2)
 
 #include <MySensors.h>
+#include <SendQueue.h>
 
 #define IR_SENSOR_PIN 3
 #define LED_PIN 4
@@ -17,6 +18,7 @@ MyMessage msg(0, V_CUSTOM);
 unsigned long irTime = 4000000000UL;
 boolean blinkLed = false;
 boolean irEvent = false;
+SendQueue sendQueue;
 
 void before()
 {
@@ -36,6 +38,11 @@ void presentation()
   present(0, S_CUSTOM);
 }
 
+void receive(const MyMessage &message)
+{
+  sendQueue.receive(message);
+}
+
 void loop()
 {
   if (irEvent) {
@@ -57,6 +64,8 @@ void loop()
     }
   }
 
+  sendQueue.process();
+
   if (blinkLed) {
     static boolean ledOn = false;
     static unsigned long blinkTimer = 0;
@@ -74,16 +83,16 @@ void changeState(state_enum state) {
     case STOPPED:
       digitalWrite(LED_PIN, LOW);
       blinkLed = false;
-      sendWithRetry(msg.set(F("stopped")), 10);
+      sendQueue.push(msg.set(F("stopped")));
       break;
     case RUNNING:
       digitalWrite(LED_PIN, HIGH);
       blinkLed = false;
-      sendWithRetry(msg.set(F("running")), 10);
+      sendQueue.push(msg.set(F("running")));
       break;
     case PENDING:
       blinkLed = true;
-      sendWithRetry(msg.set(F("pending")), 10);
+      sendQueue.push(msg.set(F("pending")));
       break;
   }
 
@@ -93,26 +102,3 @@ void changeState(state_enum state) {
 void irHandler() {
   irEvent = true;
 }
-
-void sendWithRetry(MyMessage &message, const byte retryNumber) {
-  byte counter = retryNumber;
-  bool success = false;
-
-  do {
-    success = send(message, true);
-
-    if (success) {
-      success = wait(500, message.getCommand(), message.type);
-
-      if (!success) {
-        Serial.println("no software ACK");
-      }
-    } else {
-      Serial.println("no hardware ACK");
-    }
-    
-    if (!success && counter != 0 && (retryNumber - counter) > 0) {
-      sleep(500 * (retryNumber - counter));
-    }
-  } while (!success && counter--);
-}
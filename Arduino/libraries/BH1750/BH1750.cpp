@@ -191,30 +191,87 @@ bool BH1750::setMTreg(byte MTreg) {
 }
 
 /**
- * Checks whether enough time has gone to read a new value
- * @param maxWait a boolean if to wait for typical or maximum delay
- * @return a boolean if a new measurement is possible
- *
+ * Start a measurement without waiting
+ * The MTreg chosen by the automatic ranging is applied first. Unlike
+ * configure(), no wake up delay is needed: the sensor powers up, integrates
+ * and, in one-time modes, powers down on its own.
+ * @param mode Measurement mode
+ * @return bool true if the command was acknowledged
  */
-bool BH1750::measurementReady(bool maxWait) {
+bool BH1750::startMeasurement(Mode mode) {
+
+  byte ack = 0;
+
+  if (BH1750_NextMTreg != 0) {
+    I2C->beginTransmission(BH1750_I2CADDR);
+    __wire_write((0b01000 << 3) | (BH1750_NextMTreg >> 5));
+    ack = I2C->endTransmission();
+    I2C->beginTransmission(BH1750_I2CADDR);
+    __wire_write((0b011 << 5) | (BH1750_NextMTreg & 0b11111));
+    ack = ack | I2C->endTransmission();
+
+    if (ack == 0) {
+      BH1750_MTreg = BH1750_NextMTreg;
+    }
+    BH1750_NextMTreg = 0;
+  }
+
+  I2C->beginTransmission(BH1750_I2CADDR);
+  __wire_write((uint8_t)mode);
+  ack = ack | I2C->endTransmission();
+
+  BH1750_MODE = mode;
+  lastReadTimestamp = millis();
+
+  return ack == 0;
+}
+
+/**
+ * Enable automatic MTreg ranging
+ * After each reading the MTreg of the next measurement is adjusted to keep
+ * the raw value between BH1750_AUTO_RANGE_LOW and BH1750_AUTO_RANGE_HIGH:
+ * longer integration in the dark for resolution, shorter in bright light to
+ * avoid saturation.
+ * @param enable true to enable
+ */
+void BH1750::setAutoRange(bool enable) {
+  BH1750_AutoRange = enable;
+}
+
+/**
+ * Measurement time for the current mode and MTreg
+ * @param maxWait a boolean if to use the typical or maximum time
+ * @return the measurement time in milliseconds
+ */
+unsigned long BH1750::measurementTime(bool maxWait) {
   unsigned long delaytime = 0;
   switch (BH1750_MODE) {
   case BH1750::CONTINUOUS_HIGH_RES_MODE:
   case BH1750::CONTINUOUS_HIGH_RES_MODE_2:
   case BH1750::ONE_TIME_HIGH_RES_MODE:
   case BH1750::ONE_TIME_HIGH_RES_MODE_2:
-    maxWait ? delaytime = (180 * BH1750_MTreg / (byte)BH1750_DEFAULT_MTREG)
-            : delaytime = (120 * BH1750_MTreg / (byte)BH1750_DEFAULT_MTREG);
+    maxWait ? delaytime = (180UL * BH1750_MTreg / (byte)BH1750_DEFAULT_MTREG)
+            : delaytime = (120UL * BH1750_MTreg / (byte)BH1750_DEFAULT_MTREG);
     break;
   case BH1750::CONTINUOUS_LOW_RES_MODE:
   case BH1750::ONE_TIME_LOW_RES_MODE:
-    // Send mode to sensor
-    maxWait ? delaytime = (24 * BH1750_MTreg / (byte)BH1750_DEFAULT_MTREG)
-            : delaytime = (16 * BH1750_MTreg / (byte)BH1750_DEFAULT_MTREG);
+    maxWait ? delaytime = (24UL * BH1750_MTreg / (byte)BH1750_DEFAULT_MTREG)
+            : delaytime = (16UL * BH1750_MTreg / (byte)BH1750_DEFAULT_MTREG);
     break;
   default:
     break;
   }
+  return delaytime;
+}
+
+/**
+ * Checks whether enough time has gone to read a new value
+ * @param maxWait a boolean if to wait for typical or maximum delay
+ * @return a boolean if a new measurement is possible
+ *
+ */
+bool BH1750::measurementReady(bool maxWait) {
+  unsigned long delaytime = measurementTime(maxWait);
   // Wait for new measurement to be possible.
   // Measurements have a maximum measurement time and a typical measurement
   // time. The maxWait argument determines which measurement wait time is
@@ -255,6 +312,18 @@ float BH1750::readLightLevel() {
     tmp <<= 8;
     tmp |= __wire_read();
     level = tmp;
+
+    // Choose the MTreg of the next measurement
+    if (BH1750_AutoRange &&
+        (tmp < BH1750_AUTO_RANGE_LOW || tmp > BH1750_AUTO_RANGE_HIGH)) {
+      unsigned long MTreg = (unsigned long)BH1750_MTreg *
+                            BH1750_AUTO_RANGE_TARGET / (tmp > 0 ? tmp : 1);
+      MTreg = constrain(MTreg, BH1750_MIN_MTREG, BH1750_MAX_MTREG);
+
+      if (MTreg != BH1750_MTreg) {
+        BH1750_NextMTreg = MTreg;
+      }
+    }
   }
   lastReadTimestamp = millis();
 
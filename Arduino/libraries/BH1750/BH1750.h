@@ -39,6 +39,15 @@
 // Default MTreg value
 #define BH1750_DEFAULT_MTREG 69
 
+// MTreg range
+#define BH1750_MIN_MTREG 32
+#define BH1750_MAX_MTREG 254
+
+// Raw value window kept by the automatic MTreg ranging
+#define BH1750_AUTO_RANGE_LOW 5000
+#define BH1750_AUTO_RANGE_HIGH 50000
+#define BH1750_AUTO_RANGE_TARGET 20000
+
 class BH1750 {
 
 public:
@@ -65,11 +74,17 @@ public:
   bool configure(Mode mode);
   bool setMTreg(byte MTreg);
   bool measurementReady(bool maxWait = false);
+  unsigned long measurementTime(bool maxWait = false);
+  bool startMeasurement(Mode mode);
+  void setAutoRange(bool enable);
   float readLightLevel();
 
 private:
   byte BH1750_I2CADDR;
   byte BH1750_MTreg = (byte)BH1750_DEFAULT_MTREG;
+  // MTreg to apply on the next startMeasurement(), 0 if unchanged
+  byte BH1750_NextMTreg = 0;
+  bool BH1750_AutoRange = false;
   // Correction factor used to calculate lux. Typical value is 1.2 but can
   // range from 0.96 to 1.44. See the data sheet (p.2, Measurement Accuracy)
   // for more information.
@@ -1,71 +1,225 @@
-#include "batterylevel.h"
+#include "BatteryLevel.h"
 #include <EEPROM.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
 
-const int _lionTab[] = {3500, 3550, 3590, 3610, 3640, 3710, 3790, 3880, 3970, 4080, 4200};
+#if defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define ADMUX_VCCWRT1V1 (_BV(REFS0) | _BV(MUX4) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1))
+#else
+#define ADMUX_VCCWRT1V1 (_BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1))
+#endif
+
+#define NO_TRACKING 0xFFFFFFFF
+
+// discharge curves in millivolts, points evenly spaced from 0 to 100%
+const uint16_t _lionCurve[] PROGMEM = {3500, 3550, 3590, 3610, 3640, 3710, 3790, 3880, 3970, 4080, 4200};
+const uint16_t _alkalineCurve[] PROGMEM = {2800, 4800};
+const uint16_t _cr2032Curve[] PROGMEM = {2400, 3000};
+const uint16_t _leadAcid12vCurve[] PROGMEM = {12000, 13000};
+
+const BatteryCurve LITHIUM_CURVE = {_lionCurve, sizeof(_lionCurve) / sizeof(_lionCurve[0]), 150};
+const BatteryCurve ALKALINE_CURVE = {_alkalineCurve, sizeof(_alkalineCurve) / sizeof(_alkalineCurve[0]), 300};
+const BatteryCurve CR2032_CURVE = {_cr2032Curve, sizeof(_cr2032Curve) / sizeof(_cr2032Curve[0]), 15000};
+const BatteryCurve LEAD_ACID_12V_CURVE = {_leadAcid12vCurve, sizeof(_leadAcid12vCurve) / sizeof(_leadAcid12vCurve[0]), 50};
+
+// ADC conversion complete wakes up the MCU from noise reduction sleep
+EMPTY_INTERRUPT(ADC_vect);
 
 BatteryLevel::BatteryLevel(int pinBatteryLevel, uint32_t eepromAddress, BatteryType batteryType)
+  : BatteryLevel(pinBatteryLevel, eepromAddress,
+                 batteryType == Lithium ? LITHIUM_CURVE : batteryType == Alkaline ? ALKALINE_CURVE : CR2032_CURVE)
+{
+}
+
+BatteryLevel::BatteryLevel(int pinBatteryLevel, uint32_t eepromAddress, const BatteryCurve &curve)
 {
   _pinBatteryLevel = pinBatteryLevel;
   _eepromAddress = eepromAddress;
-  _batteryType = batteryType;
+  _trackerAddress = NO_TRACKING;
+  _curve = &curve;
+  _filter = 0;
+  _percent = 0;
+  setDivider(470000, 100000);
 }
 
 void BatteryLevel::init() {
-  _voltageCorrection = getVoltageCorrection();
-    
-  if (_pinBatteryLevel == INTERNAL_MEASUREMENT) {
-    vcc = new Vcc(_voltageCorrection);
-  } else {
+  _correction = (uint16_t)(getVoltageCorrection() * 10000.0 + 0.5);
+
+  if (_pinBatteryLevel != INTERNAL_MEASUREMENT) {
     pinMode(_pinBatteryLevel, INPUT);
     analogReference(INTERNAL);
   }
-  
+
   compute(); // first read is wrong
+  _filter = 0;
+}
+
+void BatteryLevel::setDivider(uint32_t r1, uint32_t r2) {
+  _dividerFactor = (1100UL * (r1 + r2) + r2 / 2) / r2;
 }
 
 void BatteryLevel::compute() {
+  compute(0);
+}
+
+void BatteryLevel::compute(uint16_t loadMilliamps) {
   _oldPercent = _percent;
-  
+
+  // add back the voltage drop on the internal resistance
+  _rawMillivolts = readMillivolts() + (uint32_t)loadMilliamps * _curve->resistance / 1000UL;
+
+  if (_filter == 0) {
+    _filter = _rawMillivolts << BATTERY_EMA_SHIFT;
+  } else {
+    _filter = _filter - (_filter >> BATTERY_EMA_SHIFT) + _rawMillivolts;
+  }
+
+  _millivolts = (_filter + (1 << (BATTERY_EMA_SHIFT - 1))) >> BATTERY_EMA_SHIFT;
+  _percent = computePercent(_millivolts);
+}
+
+uint16_t BatteryLevel::readMillivolts() {
+  uint32_t millivolts;
+
   if (_pinBatteryLevel == INTERNAL_MEASUREMENT) {
-    _voltage = vcc->Read_Volts();
+    // read 1.1V reference against AVcc
+    if (ADMUX != ADMUX_VCCWRT1V1) {
+      ADMUX = ADMUX_VCCWRT1V1;
+      delayMicroseconds(350); // wait for Vref to settle
+    }
+
+    uint16_t sum = sampleAdc();
+    millivolts = sum > 0 ? (1100UL * 1024UL * BATTERY_SAMPLES + sum / 2) / sum : 0;
   } else {
-    int analog = analogRead(_pinBatteryLevel);  // 0 - 1023
-    float u2 = (analog * 1.1) / 1023.0;
-    _voltage = (u2 * (470000.0 + 100000.0)) / 100000.0;
-    _voltage *= _voltageCorrection;
+    analogRead(_pinBatteryLevel); // select the channel, result is discarded
+
+    // 1.1V reference with r1 / r2 divider: mV = adc * 1100 * (r1 + r2) / (1023 * r2)
+    uint32_t sum = sampleAdc();
+    millivolts = (sum * _dividerFactor + 1023UL * BATTERY_SAMPLES / 2) / (1023UL * BATTERY_SAMPLES);
+  }
+
+  millivolts = (millivolts * _correction + 5000UL) / 10000UL;
+
+  // keep the filter accumulator in range on a bad reading
+  return min(millivolts, 16000UL);
+}
+
+uint16_t BatteryLevel::sampleAdc() {
+  uint16_t sum = 0;
+
+  set_sleep_mode(SLEEP_MODE_ADC);
+  ADCSRA |= _BV(ADIE);
+
+  for (byte i = 0; i < BATTERY_SAMPLES; i++) {
+    // entering ADC noise reduction sleep starts the conversion
+    noInterrupts();
+    sleep_enable();
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
+
+    // another interrupt may have woken up the MCU before the end of conversion
+    while (bit_is_set(ADCSRA, ADSC)) {};
+
+    sum += ADC;
   }
-  
-  int um = round(_voltage * 1000.0);
-
-  if (_batteryType == Lithium) {
-    for (int i = 10; i >= 0; i--) {
-      if (um >= _lionTab[i]) {
-        if (i == 10) {
-          _percent = 100;
-        } else {
-          _percent = map(um, _lionTab[i], _lionTab[i + 1], i * 10, i * 10 + 10);
-        }
-    
-        break;
-      } else {
-        _percent = 0;
-      }
+
+  ADCSRA &= ~_BV(ADIE);
+
+  return sum;
+}
+
+byte BatteryLevel::computePercent(uint16_t millivolts) {
+  const uint16_t* curve = _curve->points;
+  byte size = _curve->size;
+
+  if (millivolts <= pgm_read_word(&curve[0])) {
+    return 0;
+  } else if (millivolts >= pgm_read_word(&curve[size - 1])) {
+    return 100;
+  }
+
+  // find the segment curve[low] <= millivolts < curve[high]
+  byte low = 0;
+  byte high = size - 1;
+
+  while (high - low > 1) {
+    byte middle = (low + high) / 2;
+
+    if (millivolts < pgm_read_word(&curve[middle])) {
+      high = middle;
+    } else {
+      low = middle;
     }
-  } else if (_batteryType == Alkaline) {
-    _percent = map(um, 2800, 4800, 0, 100);
-  } else if (_batteryType == CR2032_LITHIUM) {
-    _percent = map(um, 2400, 3000, 0, 100);
   }
 
-  if (_percent < 0) {
-    _percent = 0;
-  } else if (_percent > 100) {
-    _percent = 100;
+  uint16_t lowMillivolts = pgm_read_word(&curve[low]);
+  uint16_t range = pgm_read_word(&curve[high]) - lowMillivolts;
+
+  return (low * 100UL * range + (millivolts - lowMillivolts) * 100UL) / ((size - 1) * (uint32_t)range);
+}
+
+void BatteryLevel::enableDischargeTracking(uint32_t eepromAddress) {
+  _trackerAddress = eepromAddress;
+  EEPROM.get(_trackerAddress, _tracker);
+
+  // erased eeprom
+  if (_tracker.referencePercent > 100) {
+    _tracker.referencePercent = _percent;
+    _tracker.hours = 0;
+    _tracker.rate = 0;
   }
 }
 
+void BatteryLevel::trackDischarge(uint16_t elapsedHours) {
+  if (_trackerAddress == NO_TRACKING) {
+    return;
+  }
+
+  _tracker.hours = min((uint32_t)_tracker.hours + elapsedHours, 0xFFFFUL);
+
+  // smaller rises are noise or a warmer battery: keep accumulating the hours
+  if (_percent >= _tracker.referencePercent + BATTERY_TRACK_REPLACED ||
+      (_percent == 100 && _tracker.referencePercent < 100)) {
+    // battery replaced or charged: restart from the new level
+    _tracker.referencePercent = _percent;
+    _tracker.hours = 0;
+  } else if (_tracker.referencePercent - _percent >= BATTERY_TRACK_MIN_DROP && _tracker.hours > 0) {
+    uint32_t rate = (_tracker.referencePercent - _percent) * 2400UL / _tracker.hours;
+    rate = min(rate, 0xFFFFUL);
+
+    if (_tracker.rate == 0) {
+      _tracker.rate = rate;
+    } else {
+      _tracker.rate = (rate + 3UL * _tracker.rate + 2) / 4;
+    }
+
+    _tracker.referencePercent = _percent;
+    _tracker.hours = 0;
+  }
+
+  EEPROM.put(_trackerAddress, _tracker);
+}
+
+uint16_t BatteryLevel::getDaysRemaining() {
+  if (_trackerAddress == NO_TRACKING || _tracker.rate == 0) {
+    return BATTERY_DAYS_UNKNOWN;
+  }
+
+  return min(_percent * 100UL / _tracker.rate, (uint32_t)BATTERY_DAYS_UNKNOWN - 1);
+}
+
 float BatteryLevel::getVoltage() {
-  return _voltage;
+  return _millivolts / 1000.0;
+}
+
+uint16_t BatteryLevel::getMillivolts() {
+  return _millivolts;
+}
+
+// The filtered value lags the battery by several compute(), cutoffs use this one
+uint16_t BatteryLevel::getRawMillivolts() {
+  return _rawMillivolts;
 }
 
 int BatteryLevel::getPercent() {
@@ -87,7 +241,7 @@ void BatteryLevel::saveVoltageCorrection(float value) {
     EEPROM.update(_eepromAddress + i, b[i]);
   }
 
-  _voltageCorrection = value;
+  _correction = (uint16_t)(value * 10000.0 + 0.5);
 }
 
 float BatteryLevel::getVoltageCorrection() {
@@ -2,34 +2,72 @@
 #define BatteryLevel_h
 
 #include "Arduino.h"
-#include <Vcc.h>
 
 #define INTERNAL_MEASUREMENT 255
 
+#define BATTERY_SAMPLES 8          // ADC samples averaged for each measurement
+#define BATTERY_EMA_SHIFT 2        // filter weight of a new measurement is 1 / 2^shift
+#define BATTERY_TRACK_MIN_DROP 2   // percent drop needed to update the discharge rate
+#define BATTERY_TRACK_REPLACED 10  // percent rise taken as a battery replacement or charge
+#define BATTERY_DAYS_UNKNOWN 0xFFFF
+
 enum BatteryType { Lithium, Alkaline, CR2032_LITHIUM };
 
+struct BatteryCurve {
+  const uint16_t* points;  // PROGMEM millivolts, evenly spaced from 0 to 100%
+  byte size;
+  uint16_t resistance;     // internal resistance in milliohms used for load compensation
+};
+
+extern const BatteryCurve LITHIUM_CURVE;
+extern const BatteryCurve ALKALINE_CURVE;
+extern const BatteryCurve CR2032_CURVE;
+extern const BatteryCurve LEAD_ACID_12V_CURVE;
+
+struct DischargeTracker {
+  byte referencePercent;
+  uint16_t hours;          // elapsed hours since reference
+  uint16_t rate;           // hundredths of percent per day
+};
+
 class BatteryLevel
 {
   public:
     BatteryLevel(int pinBatteryLevel, uint32_t eepromAddress, BatteryType batteryType);
+    BatteryLevel(int pinBatteryLevel, uint32_t eepromAddress, const BatteryCurve &curve);
     void init();
+    void setDivider(uint32_t r1, uint32_t r2);
     void compute();
+    void compute(uint16_t loadMilliamps);
     float getVoltage();
+    uint16_t getMillivolts();
+    uint16_t getRawMillivolts();
     int getPercent();
     void saveVoltageCorrection(float value);
     float getVoltageCorrection();
     bool hasChanged();
     bool hasChanged(int gap);
+    void enableDischargeTracking(uint32_t eepromAddress); // 5 bytes storage
+    void trackDischarge(uint16_t elapsedHours);
+    uint16_t getDaysRemaining();
 
   private:
+    uint16_t readMillivolts();
+    uint16_t sampleAdc();
+    byte computePercent(uint16_t millivolts);
+
     int _pinBatteryLevel;
-    float _voltageCorrection;
+    uint16_t _correction;     // voltage correction x 10000
+    uint16_t _dividerFactor;  // millivolts at ADC full scale for the resistor divider
     uint32_t _eepromAddress;
-    float _voltage;
+    uint32_t _trackerAddress;
+    uint16_t _millivolts;
+    uint16_t _rawMillivolts;  // last measurement, not filtered
+    uint16_t _filter;         // millivolts << BATTERY_EMA_SHIFT, 0 until first measurement
     int _percent;
     int _oldPercent;
-    BatteryType _batteryType;
-    Vcc *vcc;
+    const BatteryCurve* _curve;
+    DischargeTracker _tracker;
 };
 
 #endif
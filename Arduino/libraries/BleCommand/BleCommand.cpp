@@ -0,0 +1,298 @@
+#include "BleCommand.h"
+#include <EEPROM.h>
+
+LineReader::LineReader(Stream &stream) : _stream(stream) {
+  _length = 0;
+  _complete = false;
+  _overflow = false;
+}
+
+// true when a whole line is available in getLine(), '\r' is dropped
+bool LineReader::read() {
+  if (_complete) {
+    _length = 0;
+    _complete = false;
+  }
+
+  while (_stream.available()) {
+    char c = _stream.read();
+
+    if (c == '\n') {
+      _line[_length] = 0;
+
+      if (_overflow) {
+        _overflow = false;
+        _length = 0;
+      } else {
+        _complete = true;
+        return true;
+      }
+    } else if (c == '\r') {
+      continue;
+    } else if (_length < LINE_READER_SIZE - 1) {
+      _line[_length++] = c;
+    } else {
+      _overflow = true;
+    }
+  }
+
+  return false;
+}
+
+char* LineReader::getLine() {
+  _line[_length] = 0;
+  return _line;
+}
+
+BleCommand::BleCommand(Stream &stream) : _stream(stream), _reader(stream) {
+  _commandCount = 0;
+  _fieldCount = 0;
+  _dataHandler = NULL;
+}
+
+void BleCommand::addCommand(const __FlashStringHelper *key, BleHandler handler) {
+  if (_commandCount < BLE_COMMAND_MAX) {
+    _commands[_commandCount].key = key;
+    _commands[_commandCount].handler = handler;
+    _commandCount++;
+  }
+}
+
+void BleCommand::addByte(const __FlashStringHelper *key, byte *value, int eeprom, byte minValue, byte maxValue,
+                         byte defaultValue, BleHandler onChange) {
+  addField(key, FIELD_BYTE, value, eeprom, minValue, maxValue, defaultValue, onChange);
+}
+
+void BleCommand::addInt(const __FlashStringHelper *key, int *value, int eeprom, int minValue, int maxValue,
+                        int defaultValue, BleHandler onChange) {
+  addField(key, FIELD_INT, value, eeprom, minValue, maxValue, defaultValue, onChange);
+}
+
+void BleCommand::addColor(const __FlashStringHelper *key, byte *rgb, int eeprom, BleHandler onChange) {
+  addField(key, FIELD_COLOR, rgb, eeprom, 0, 0, 0, onChange);
+}
+
+void BleCommand::addField(const __FlashStringHelper *key, byte type, void *value, int eeprom, int minValue,
+                          int maxValue, int defaultValue, BleHandler onChange) {
+  if (_fieldCount < BLE_FIELD_MAX) {
+    Field *field = &_fields[_fieldCount++];
+    field->key = key;
+    field->type = type;
+    field->value = value;
+    field->eeprom = eeprom;
+    field->minValue = minValue;
+    field->maxValue = maxValue;
+    field->defaultValue = defaultValue;
+    field->onChange = onChange;
+  }
+}
+
+void BleCommand::onData(BleDataHandler handler) {
+  _dataHandler = handler;
+}
+
+// Read the fields from their EEPROM slot, an erased or out of range value
+// loads the default
+void BleCommand::load() {
+  for (byte i = 0; i < _fieldCount; i++) {
+    Field *field = &_fields[i];
+    int value = field->defaultValue;
+
+    if (field->type == FIELD_COLOR) {
+      if (field->eeprom != BLE_NO_EEPROM) {
+        for (byte c = 0; c < 3; c++) {
+          ((byte*)field->value)[c] = EEPROM.read(field->eeprom + c);
+        }
+      }
+      continue;
+    }
+
+    if (field->eeprom != BLE_NO_EEPROM) {
+      if (field->type == FIELD_BYTE) {
+        value = EEPROM.read(field->eeprom);
+      } else {
+        EEPROM.get(field->eeprom, value);
+      }
+
+      if (value < field->minValue || value > field->maxValue) {
+        value = field->defaultValue;
+      }
+    }
+
+    if (field->type == FIELD_BYTE) {
+      *(byte*)field->value = value;
+    } else {
+      *(int*)field->value = value;
+    }
+  }
+}
+
+// Call from loop(), returns true when a line was received
+bool BleCommand::process() {
+  if (!_reader.read()) {
+    return false;
+  }
+
+  dispatch(_reader.getLine());
+  return true;
+}
+
+void BleCommand::dispatch(char *line) {
+  if (strncmp_P(line, PSTR("cmd+"), 4) != 0) {
+    return;
+  }
+
+  char *key = line + 4;
+  char *separator = strchr(key, '=');
+  char *value = key + strlen(key);
+
+  if (separator != NULL) {
+    *separator = 0;
+    value = separator + 1;
+  }
+
+  if (strcmp_P(key, PSTR("data?")) == 0) {
+    sendData();
+  } else if (!runCommand(key, value)) {
+    set(key, value);
+  }
+
+  // the sketch gets the line back untouched
+  if (separator != NULL) {
+    *separator = '=';
+  }
+}
+
+bool BleCommand::runCommand(const char *key, const char *value) {
+  for (byte i = 0; i < _commandCount; i++) {
+    if (strcmp_P(key, (PGM_P)_commands[i].key) == 0) {
+      _commands[i].handler(value);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Set a field from its text value, false if the key is unknown or the value invalid
+bool BleCommand::set(const char *key, const char *value) {
+  Field *field = findField(key);
+
+  if (field == NULL) {
+    return false;
+  }
+
+  if (field->type == FIELD_COLOR) {
+    byte rgb[3];
+
+    if (!parseColor(value, rgb)) {
+      return false;
+    }
+
+    for (byte c = 0; c < 3; c++) {
+      ((byte*)field->value)[c] = rgb[c];
+
+      if (field->eeprom != BLE_NO_EEPROM) {
+        EEPROM.update(field->eeprom + c, rgb[c]);
+      }
+    }
+  } else if (!store(field, atol(value))) {
+    return false;
+  }
+
+  print(field);
+
+  if (field->onChange != NULL) {
+    field->onChange(value);
+  }
+
+  return true;
+}
+
+bool BleCommand::store(Field *field, long value) {
+  if (value < field->minValue || value > field->maxValue) {
+    return false;
+  }
+
+  if (field->type == FIELD_BYTE) {
+    *(byte*)field->value = value;
+
+    if (field->eeprom != BLE_NO_EEPROM) {
+      EEPROM.update(field->eeprom, (byte)value);
+    }
+  } else {
+    *(int*)field->value = value;
+
+    if (field->eeprom != BLE_NO_EEPROM) {
+      EEPROM.put(field->eeprom, *(int*)field->value);
+    }
+  }
+
+  return true;
+}
+
+BleCommand::Field* BleCommand::findField(const char *key) {
+  for (byte i = 0; i < _fieldCount; i++) {
+    if (strcmp_P(key, (PGM_P)_fields[i].key) == 0) {
+      return &_fields[i];
+    }
+  }
+
+  return NULL;
+}
+
+// Reply to "cmd+data?"
+void BleCommand::sendData() {
+  if (_dataHandler != NULL) {
+    _dataHandler();
+  }
+
+  for (byte i = 0; i < _fieldCount; i++) {
+    print(&_fields[i]);
+  }
+}
+
+void BleCommand::print(Field *field) {
+  _stream.print(field->key);
+  _stream.print(':');
+
+  if (field->type == FIELD_COLOR) {
+    static const char digits[] = "0123456789abcdef";
+
+    for (byte c = 0; c < 3; c++) {
+      byte value = ((byte*)field->value)[c];
+      _stream.print(digits[value >> 4]);
+      _stream.print(digits[value & 0x0F]);
+    }
+
+    _stream.println();
+  } else if (field->type == FIELD_BYTE) {
+    _stream.println(*(byte*)field->value);
+  } else {
+    _stream.println(*(int*)field->value);
+  }
+}
+
+char* BleCommand::getLine() {
+  return _reader.getLine();
+}
+
+// "rrggbb" in hexadecimal
+bool BleCommand::parseColor(const char *value, byte *rgb) {
+  if (strlen(value) != 6) {
+    return false;
+  }
+
+  for (byte i = 0; i < 6; i++) {
+    if (!isxdigit(value[i])) {
+      return false;
+    }
+  }
+
+  for (byte c = 0; c < 3; c++) {
+    char hex[3] = {value[c * 2], value[c * 2 + 1], 0};
+    rgb[c] = strtol(hex, NULL, 16);
+  }
+
+  return true;
+}
@@ -0,0 +1,100 @@
+#ifndef BleCommand_h
+#define BleCommand_h
+
+#include "Arduino.h"
+
+#ifndef LINE_READER_SIZE
+#define LINE_READER_SIZE 40  // longest line + 1, longer lines are dropped
+#endif
+
+#ifndef BLE_COMMAND_MAX
+#define BLE_COMMAND_MAX 6
+#endif
+
+#ifndef BLE_FIELD_MAX
+#define BLE_FIELD_MAX 6
+#endif
+
+#define BLE_NO_EEPROM -1
+
+typedef void (*BleHandler)(const char *value);
+typedef void (*BleDataHandler)();
+
+// Assembles a line from the bytes already received, never waits for the next one
+class LineReader
+{
+  public:
+    LineReader(Stream &stream);
+    bool read();
+    char* getLine();
+
+  private:
+    Stream &_stream;
+    char _line[LINE_READER_SIZE];
+    byte _length;
+    bool _complete;
+    bool _overflow;
+};
+
+// Dispatches "cmd+key" and "cmd+key=value" lines:
+// - a command calls its handler with the value ("" without one)
+// - a field parses the value, checks its range, saves it in its EEPROM slot,
+//   replies "key:value" then calls its handler
+// "cmd+data?" replies the data handler lines then every field.
+// Commands are matched first, a command can shadow the setter of a field
+// with the same key and call set() itself.
+class BleCommand
+{
+  public:
+    BleCommand(Stream &stream);
+    void addCommand(const __FlashStringHelper *key, BleHandler handler);
+    void addByte(const __FlashStringHelper *key, byte *value, int eeprom, byte minValue, byte maxValue,
+                 byte defaultValue, BleHandler onChange = NULL);
+    void addInt(const __FlashStringHelper *key, int *value, int eeprom, int minValue, int maxValue,
+                int defaultValue, BleHandler onChange = NULL);
+    void addColor(const __FlashStringHelper *key, byte *rgb, int eeprom, BleHandler onChange = NULL);
+    void onData(BleDataHandler handler);
+    void load();
+    bool process();
+    bool set(const char *key, const char *value);
+    void sendData();
+    char* getLine();
+    static bool parseColor(const char *value, byte *rgb);
+
+  private:
+    enum FieldType { FIELD_BYTE, FIELD_INT, FIELD_COLOR };
+
+    struct Command {
+      const __FlashStringHelper *key;
+      BleHandler handler;
+    };
+
+    struct Field {
+      const __FlashStringHelper *key;
+      byte type;
+      void *value;
+      int eeprom;
+      int minValue;
+      int maxValue;
+      int defaultValue;
+      BleHandler onChange;
+    };
+
+    void addField(const __FlashStringHelper *key, byte type, void *value, int eeprom, int minValue,
+                  int maxValue, int defaultValue, BleHandler onChange);
+    void dispatch(char *line);
+    bool runCommand(const char *key, const char *value);
+    Field* findField(const char *key);
+    bool store(Field *field, long value);
+    void print(Field *field);
+
+    Stream &_stream;
+    LineReader _reader;
+    Command _commands[BLE_COMMAND_MAX];
+    Field _fields[BLE_FIELD_MAX];
+    byte _commandCount;
+    byte _fieldCount;
+    BleDataHandler _dataHandler;
+};
+
+#endif
@@ -138,3 +138,62 @@ bool Bounce::fell()
 {
     return  !getStateFlag(DEBOUNCED_STATE) && getStateFlag(CHANGED_STATE);
 }
+
+
+#if defined(__AVR__)
+
+BounceBank::BounceBank()
+    : port(NULL)
+    , mask(0)
+    , state(0)
+    , changed(0)
+    , count0(0xFF)
+    , count1(0xFF)
+    , tick_millis(3)
+    , previous_millis(0)
+{}
+
+bool BounceBank::attach(uint8_t pin, uint8_t mode)
+{
+    volatile uint8_t *pinPort = portInputRegister(digitalPinToPort(pin));
+
+    if (port != NULL && port != pinPort) {
+        return false;
+    }
+
+    port = pinPort;
+    pinMode(pin, mode);
+
+    uint8_t bit = digitalPinToBitMask(pin);
+    mask |= bit;
+    state = (state & ~bit) | (*port & bit);
+    return true;
+}
+
+void BounceBank::interval(uint16_t interval_millis)
+{
+    tick_millis = constrain(interval_millis / 4, 1, 255);
+}
+
+bool BounceBank::update()
+{
+    changed = 0;
+
+    uint8_t now = millis();
+    if (port == NULL || (uint8_t)(now - previous_millis) < tick_millis) {
+        return false;
+    }
+    previous_millis = now;
+
+    // counters of the inputs equal to the debounced state are reset to 3,
+    // the others count down and the state toggles when they wrap to 3
+    uint8_t delta = (*port ^ state) & mask;
+    count0 = ~(count0 & delta);
+    count1 = count0 ^ (count1 & delta);
+    changed = delta & count0 & count1;
+    state ^= changed;
+
+    return changed != 0;
+}
+
+#endif
@@ -191,4 +191,67 @@ class Bounce
     inline bool getStateFlag(const uint8_t flag)    {return((state & flag) != 0);}
 };
 
+#if defined(__AVR__)
+
+/**
+     The BounceBank class.
+     Debounces up to 8 inputs of the same AVR port together: the port is read once per tick
+     and each input has a 2-bit vertical counter, so a change is accepted after 4 stable ticks.
+     The returned masks use the port bits, see pinMask().
+     */
+class BounceBank
+{
+ public:
+    BounceBank();
+
+/*!
+    @brief  Attach a pin and set its mode (INPUT or INPUT_PULLUP).
+    @return False if the pin is not on the port of the first attached pin.
+*/
+    bool attach(uint8_t pin, uint8_t mode);
+
+    /**
+    @brief  Sets the debounce interval in milliseconds, the port is read every interval/4 ms.
+     */
+    void interval(uint16_t interval_millis);
+
+/*!
+    @brief   Reads the port if a tick elapsed. Call it once per loop().
+    @return True if an input changed state.
+*/
+    bool update();
+
+    /**
+     @brief Returns the mask of a pin, to test the values returned by read(), rose() and fell().
+     */
+    static uint8_t pinMask(uint8_t pin) { return digitalPinToBitMask(pin); }
+
+    /**
+     @brief Returns the debounced state of the inputs.
+     */
+    uint8_t read() { return state & mask; }
+
+    /**
+    @brief Returns the inputs which transitioned from low to high during the last update().
+    */
+    uint8_t rose() { return changed & state; }
+
+    /**
+    @brief Returns the inputs which transitioned from high to low during the last update().
+    */
+    uint8_t fell() { return changed & ~state; }
+
+ protected:
+    volatile uint8_t *port;
+    uint8_t mask;
+    uint8_t state;
+    uint8_t changed;
+    uint8_t count0;
+    uint8_t count1;
+    uint8_t tick_millis;
+    uint8_t previous_millis;
+};
+
+#endif
+
 #endif
@@ -0,0 +1,144 @@
+#include "ChangeReporter.h"
+#include <EEPROM.h>
+
+#define NO_STORAGE 0xFFFFFFFF
+
+ChangeReporter::ChangeReporter(const ReportSettings &defaults) {
+  _settings = defaults;
+  _eepromAddress = NO_STORAGE;
+  _edges = NULL;
+  _edgeCount = 0;
+  _value = 0;
+  _reported = 0;
+  _silence = 0;
+  _hasValue = false;
+  _hasReported = false;
+}
+
+void ChangeReporter::begin(uint32_t eepromAddress) {
+  _eepromAddress = eepromAddress;
+
+  // erased eeprom or older layout: keep the defaults
+  if (EEPROM.read(_eepromAddress) == REPORT_SETTINGS_VERSION) {
+    EEPROM.get(_eepromAddress + 1, _settings);
+  }
+}
+
+void ChangeReporter::setBands(const long* edges, byte size) {
+  _edges = edges;
+  _edgeCount = size;
+}
+
+// returns true when value should be sent, call markReported() once it is
+bool ChangeReporter::update(long value, uint16_t elapsedMinutes) {
+  bool report = !_hasReported;
+
+  if (_hasValue && _settings.rateOfChange != REPORT_OFF) {
+    uint32_t rate = labs(value - _value) * 60UL / max(elapsedMinutes, (uint16_t)1);
+    report = report || rate >= _settings.rateOfChange;
+  }
+
+  _silence = min((uint32_t)_silence + elapsedMinutes, 0xFFFFUL);
+  _value = value;
+  _hasValue = true;
+
+  if (report) {
+    return true;
+  }
+
+  uint32_t change = labs(value - _reported);
+
+  if (_settings.deadBand != REPORT_OFF && change > _settings.deadBand) {
+    return true;
+  }
+
+  if (_settings.relativeBand != REPORT_OFF &&
+      change * 100 > labs(_reported) * _settings.relativeBand) {
+    return true;
+  }
+
+  if (_settings.heartbeat != REPORT_OFF && _silence >= _settings.heartbeat) {
+    return true;
+  }
+
+  return bandCrossed(value);
+}
+
+void ChangeReporter::markReported() {
+  _reported = _value;
+  _silence = 0;
+  _hasReported = true;
+}
+
+byte ChangeReporter::bandOf(long value) {
+  byte band = 0;
+
+  while (band < _edgeCount && value >= (long)pgm_read_dword(&_edges[band])) {
+    band++;
+  }
+
+  return band;
+}
+
+bool ChangeReporter::bandCrossed(long value) {
+  if (_edges == NULL) {
+    return false;
+  }
+
+  byte reportedBand = bandOf(_reported);
+  byte band = bandOf(value);
+
+  if (band > reportedBand) {
+    return value >= (long)pgm_read_dword(&_edges[reportedBand]) + _settings.hysteresis;
+  } else if (band < reportedBand) {
+    return value < (long)pgm_read_dword(&_edges[reportedBand - 1]) - _settings.hysteresis;
+  }
+
+  return false;
+}
+
+// command format: key=value with key in dead, rel, hyst, rate, beat
+bool ChangeReporter::configure(const char* command) {
+  const char* separator = strchr(command, '=');
+
+  if (separator == NULL || separator[1] < '0' || separator[1] > '9') {
+    return false;
+  }
+
+  byte keyLength = separator - command;
+  uint32_t value = strtoul(separator + 1, NULL, 10);
+
+  if (value > 0xFFFF) {
+    return false;
+  }
+
+  if (keyLength == 4 && strncmp(command, "dead", 4) == 0) {
+    _settings.deadBand = value;
+  } else if (keyLength == 3 && strncmp(command, "rel", 3) == 0 && value <= 255) {
+    _settings.relativeBand = value;
+  } else if (keyLength == 4 && strncmp(command, "hyst", 4) == 0) {
+    _settings.hysteresis = value;
+  } else if (keyLength == 4 && strncmp(command, "rate", 4) == 0) {
+    _settings.rateOfChange = value;
+  } else if (keyLength == 4 && strncmp(command, "beat", 4) == 0) {
+    _settings.heartbeat = value;
+  } else {
+    return false;
+  }
+
+  saveSettings();
+  return true;
+}
+
+const ReportSettings& ChangeReporter::getSettings() {
+  return _settings;
+}
+
+void ChangeReporter::saveSettings() {
+  if (_eepromAddress == NO_STORAGE) {
+    return;
+  }
+
+  EEPROM.update(_eepromAddress, REPORT_SETTINGS_VERSION);
+  EEPROM.put(_eepromAddress + 1, _settings);
+}
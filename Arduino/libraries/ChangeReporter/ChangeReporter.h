@@ -0,0 +1,46 @@
+#ifndef ChangeReporter_h
+#define ChangeReporter_h
+
+#include "Arduino.h"
+
+#define REPORT_SETTINGS_VERSION 1
+#define REPORT_SETTINGS_EEPROM_SIZE (sizeof(ReportSettings) + 1)
+#define REPORT_OFF 0
+
+// a field set to REPORT_OFF disables its trigger
+struct ReportSettings {
+  uint16_t deadBand;      // change from the last reported value needed to report
+  byte relativeBand;      // same as a percentage of the last reported value
+  uint16_t hysteresis;    // margin past a band edge before its crossing is reported
+  uint16_t rateOfChange;  // change per hour between two samples reported at once
+  uint16_t heartbeat;     // minutes of silence before the value is reported anyway
+};
+
+class ChangeReporter
+{
+  public:
+    ChangeReporter(const ReportSettings &defaults);
+    void begin(uint32_t eepromAddress);   // REPORT_SETTINGS_EEPROM_SIZE bytes storage
+    void setBands(const long* edges, byte size);
+    bool update(long value, uint16_t elapsedMinutes);
+    void markReported();
+    bool configure(const char* command);
+    const ReportSettings& getSettings();
+
+  private:
+    byte bandOf(long value);
+    bool bandCrossed(long value);
+    void saveSettings();
+
+    ReportSettings _settings;
+    uint32_t _eepromAddress;
+    const long* _edges;       // PROGMEM, ascending
+    byte _edgeCount;
+    long _value;
+    long _reported;
+    uint16_t _silence;        // minutes since the last report
+    bool _hasValue;
+    bool _hasReported;
+};
+
+#endif
@@ -25,6 +25,8 @@
    2013-06-12: Refactored code
    2013-07-01: Add a resetTimer method
    2016-07-20: Add force parameter - Torben Woltjen (mozzbozz)
+   2026-10-19: Add interrupt driven, non-blocking reading
+   2026-10-19: Poll the data line through its input register
  ******************************************************************/
 
 #include "DHT.h"
@@ -33,6 +35,9 @@ void DHT::setup(uint8_t pin, DHT_MODEL_t model)
 {
   DHT::pin = pin;
   DHT::model = model;
+  DHT::state = STATE_IDLE;
+  DHT::inputRegister = portInputRegister(digitalPinToPort(pin));
+  DHT::bitMask = digitalPinToBitMask(pin);
   DHT::resetTimer(); // Make sure we do read the sensor in the next readSensor()
 
   if ( model == AUTO_DETECT) {
@@ -160,7 +165,7 @@ void DHT::readSensor(bool force)
         return;
       }
     }
-    while ( digitalRead(pin) == (i & 1) ? HIGH : LOW );
+    while ( ((*inputRegister & bitMask) != 0) == (i & 1) );
 
     if ( i >= 0 && (i & 1) ) {
       // Now we are being fed our 40 bits
@@ -183,9 +188,14 @@ void DHT::readSensor(bool force)
     }
   }
 
+  storeReading(rawHumidity, rawTemperature, data);
+}
+
+void DHT::storeReading(word rawHumidity, word rawTemperature, byte checksum)
+{
   // Verify checksum
 
-  if ( (byte)(((byte)rawHumidity) + (rawHumidity >> 8) + ((byte)rawTemperature) + (rawTemperature >> 8)) != data ) {
+  if ( (byte)(((byte)rawHumidity) + (rawHumidity >> 8) + ((byte)rawTemperature) + (rawTemperature >> 8)) != checksum ) {
     error = ERROR_CHECKSUM;
     return;
   }
@@ -207,3 +217,115 @@ void DHT::readSensor(bool force)
 
   error = ERROR_NONE;
 }
+
+void DHT::startReading()
+{
+  if ( state != STATE_IDLE ) {
+    return;
+  }
+
+  temperature = NAN;
+  humidity = NAN;
+
+  digitalWrite(pin, LOW); // Send start signal
+  pinMode(pin, OUTPUT);
+
+  state = STATE_START_SIGNAL;
+  stateTime = millis();
+}
+
+bool DHT::processReading()
+{
+  switch ( state ) {
+    case STATE_START_SIGNAL:
+      // Hold the start signal at least 1 ms (18 ms for a DHT11)
+      if ( (unsigned long)(millis() - stateTime) < (model == DHT11 ? 19 : 2) ) {
+        return false;
+      }
+
+      fallingEdges = 0;
+      risingTime = micros();
+
+      noInterrupts();
+      pinMode(pin, INPUT);
+      digitalWrite(pin, HIGH); // Switch bus to receive data
+      lastLevel = *inputRegister & bitMask;
+      setPinChangeInterrupt(true);
+      interrupts();
+
+      state = STATE_RECEIVING;
+      stateTime = millis();
+      lastReadTime = stateTime; // getTemperature() and getHumidity() then return this reading
+      return false;
+
+    case STATE_RECEIVING:
+      // The whole frame lasts about 5 ms
+      if ( fallingEdges < 42 ) {
+        if ( (unsigned long)(millis() - stateTime) < 10 ) {
+          return false;
+        }
+
+        setPinChangeInterrupt(false);
+        state = STATE_IDLE;
+        error = ERROR_TIMEOUT;
+        return true;
+      }
+
+      setPinChangeInterrupt(false);
+      state = STATE_IDLE;
+      storeReading(((word)frame[0] << 8) | frame[1], ((word)frame[2] << 8) | frame[3], frame[4]);
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Called on every edge of the data line:
+// - First a FALLING edge for the response low and a FALLING edge after the response high
+// - Then 40 bits: a zero is high max 30 usecs, a one at least 68 usecs
+void DHT::handleInterrupt()
+{
+  unsigned long now = micros();
+
+  if ( state != STATE_RECEIVING || fallingEdges >= 42 ) {
+    return;
+  }
+
+  // The other pins of the port share the vector
+  uint8_t level = *inputRegister & bitMask;
+
+  if ( level == lastLevel ) {
+    return;
+  }
+
+  lastLevel = level;
+
+  if ( level ) {
+    risingTime = now;
+    return;
+  }
+
+  if ( fallingEdges >= 2 ) {
+    uint8_t index = (fallingEdges - 2) >> 3;
+    frame[index] <<= 1;
+
+    if ( (unsigned long)(now - risingTime) > 50 ) {
+      frame[index] |= 1; // we got a one
+    }
+  }
+
+  fallingEdges++;
+}
+
+void DHT::setPinChangeInterrupt(bool enable)
+{
+  if ( enable ) {
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    PCIFR |= _BV(digitalPinToPCICRbit(pin)); // clear pending interrupt
+    *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+  }
+  else {
+    *digitalPinToPCMSK(pin) &= ~_BV(digitalPinToPCMSKbit(pin));
+  }
+}
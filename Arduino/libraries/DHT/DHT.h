@@ -25,6 +25,7 @@
    2013-06-12: Refactored code
    2013-07-01: Add a resetTimer method
    2016-07-20: Add force parameter - Torben Woltjen (mozzbozz)
+   2026-10-19: Add interrupt driven, non-blocking reading
  ******************************************************************/
 
 #ifndef dht_h
@@ -60,6 +61,16 @@ public:
   void resetTimer();
 
   void readSensor(bool force=false);
+
+  // Non-blocking reading: startReading() sends the start signal, then
+  // processReading() has to be called from loop() until it returns true.
+  // Edges are captured by a pin change interrupt, the sketch has to forward
+  // the PCINT vector of the pin to handleInterrupt(), e.g. for pins 0 to 7:
+  //   ISR(PCINT2_vect) { dht.handleInterrupt(); }
+  void startReading();
+  bool processReading();
+  bool isReading() { return state != STATE_IDLE; };
+  void handleInterrupt();
   float getTemperature();
   float getHumidity();
 
@@ -88,9 +99,30 @@ protected:
   uint8_t pin;
 
 private:
+  typedef enum {
+    STATE_IDLE,
+    STATE_START_SIGNAL,
+    STATE_RECEIVING
+  }
+  DHT_STATE_t;
+
+  void storeReading(word rawHumidity, word rawTemperature, byte checksum);
+  void setPinChangeInterrupt(bool enable);
+
   DHT_MODEL_t model;
   DHT_ERROR_t error;
   unsigned long lastReadTime;
+
+  DHT_STATE_t state;
+  unsigned long stateTime;
+  volatile uint8_t *inputRegister;
+  uint8_t bitMask;
+
+  // written by handleInterrupt()
+  volatile uint8_t fallingEdges;
+  volatile uint8_t lastLevel;
+  volatile unsigned long risingTime;
+  volatile uint8_t frame[5];
 };
 
 #endif /*dht_h*/
@@ -4,6 +4,7 @@
 // version 2.1 of the License, or (at your option) any later version.
 
 #include "DallasTemperature.h"
+#include <EEPROM.h>
 
 
 #if ARDUINO >= 100
@@ -71,6 +72,10 @@ void DallasTemperature::setOneWire(OneWire* _oneWire){
     bitResolution = 9;
     waitForConversion = true;
     checkForConversion = true;
+    conversionPending = false;
+    _temperatureHandler = NULL;
+    deviceTable = NULL;
+    deviceTableSize = 0;
 
 }
 
@@ -80,6 +85,7 @@ void DallasTemperature::begin(void){
     DeviceAddress deviceAddress;
 
     _wire->reset_search();
+    deviceTable = NULL;
     devices = 0; // Reset the number of devices when we enumerate wire devices
 
     while (_wire->search(deviceAddress)){
@@ -96,6 +102,115 @@ void DallasTemperature::begin(void){
 
 }
 
+// initialise the bus from the device table stored in EEPROM
+// devices are addressed directly with MATCH ROM, falling back to a bus search
+// when the table crc is wrong or a device does not answer
+uint8_t DallasTemperature::begin(int eepromAddress, DeviceAddress* table, uint8_t maxDevices){
+
+    deviceTable = table;
+    deviceTableSize = maxDevices;
+    deviceTableEeprom = eepromAddress;
+
+    devices = loadDeviceTable();
+    parasite = false;
+    bitResolution = 9;
+
+    // presence pulse
+    bool valid = devices > 0 && _wire->reset() == 1;
+
+    for (uint8_t i = 0; valid && i < devices; i++){
+
+        // the scratchpad read proves the device answers, getResolution()
+        // returns 12 for a DS18S20 without touching the bus
+        ScratchPad scratchPad;
+
+        if (!isConnected(deviceTable[i], scratchPad)){
+            valid = false;
+        } else {
+            uint8_t resolution = 12;
+            if (deviceTable[i][0] != DS18S20MODEL){
+                resolution = 9 + ((scratchPad[CONFIGURATION] >> 5) & 0x03);
+            }
+
+            if (!parasite && readPowerSupply(deviceTable[i])) parasite = true;
+            bitResolution = max(bitResolution, resolution);
+        }
+    }
+
+    if (!valid) return discoverDevices();
+
+    return devices;
+
+}
+
+// search the bus, fill the device table and save it
+uint8_t DallasTemperature::discoverDevices(void){
+
+    if (deviceTable == NULL){
+        begin();
+        return devices;
+    }
+
+    DeviceAddress deviceAddress;
+
+    _wire->reset_search();
+    devices = 0;
+    parasite = false;
+    bitResolution = 9;
+
+    while (devices < deviceTableSize && _wire->search(deviceAddress)){
+
+        if (validAddress(deviceAddress)){
+
+            memcpy(deviceTable[devices], deviceAddress, sizeof(DeviceAddress));
+
+            if (!parasite && readPowerSupply(deviceAddress)) parasite = true;
+
+            bitResolution = max(bitResolution, getResolution(deviceAddress));
+
+            devices++;
+        }
+    }
+
+    saveDeviceTable();
+
+    return devices;
+
+}
+
+// EEPROM layout: device count, addresses, crc8 of the addresses
+uint8_t DallasTemperature::loadDeviceTable(void){
+
+    uint8_t count = EEPROM.read(deviceTableEeprom);
+    if (count == 0 || count > deviceTableSize) return 0;
+
+    uint8_t* data = (uint8_t*)deviceTable;
+    for (uint8_t i = 0; i < count * 8; i++){
+        data[i] = EEPROM.read(deviceTableEeprom + 1 + i);
+    }
+
+    if (_wire->crc8(data, count * 8) != EEPROM.read(deviceTableEeprom + 1 + count * 8)) return 0;
+
+    for (uint8_t i = 0; i < count; i++){
+        if (!validAddress(deviceTable[i])) return 0;
+    }
+
+    return count;
+
+}
+
+void DallasTemperature::saveDeviceTable(void){
+
+    uint8_t* data = (uint8_t*)deviceTable;
+
+    EEPROM.update(deviceTableEeprom, devices);
+    for (uint8_t i = 0; i < devices * 8; i++){
+        EEPROM.update(deviceTableEeprom + 1 + i, data[i]);
+    }
+    EEPROM.update(deviceTableEeprom + 1 + devices * 8, _wire->crc8(data, devices * 8));
+
+}
+
 // returns the number of devices found on the bus
 uint8_t DallasTemperature::getDeviceCount(void){
     return devices;
@@ -110,6 +225,13 @@ bool DallasTemperature::validAddress(const uint8_t* deviceAddress){
 // returns true if the device was found
 bool DallasTemperature::getAddress(uint8_t* deviceAddress, uint8_t index){
 
+    // fast path: no bus search with a device table
+    if (deviceTable != NULL){
+        if (index >= devices) return false;
+        memcpy(deviceAddress, deviceTable[index], sizeof(DeviceAddress));
+        return true;
+    }
+
     uint8_t depth = 0;
 
     _wire->reset_search();
@@ -408,6 +530,78 @@ int16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution){
 }
 
 
+// sends command for all devices to perform a temperature conversion without blocking
+// the conversion runs on every device at once, so a bus takes one conversion time
+void DallasTemperature::requestTemperaturesAsync(TemperatureHandler* handler){
+
+    _temperatureHandler = handler;
+
+    _wire->reset();
+    _wire->skip();
+    _wire->write(STARTCONVO, parasite);
+
+    conversionStart = millis();
+    conversionPending = true;
+
+}
+
+bool DallasTemperature::isConversionPending(void){
+    return conversionPending;
+}
+
+// returns the worst case time left for the current resolution
+// note: millis() does not advance while the MCU is in power down sleep,
+// sleeping this amount once is enough to reach the deadline
+uint16_t DallasTemperature::millisToConversionDeadline(void){
+
+    if (!conversionPending) return 0;
+
+    unsigned long elapsed = millis() - conversionStart;
+    unsigned long delms = millisToWaitForConversion(bitResolution);
+
+    return elapsed >= delms ? 0 : delms - elapsed;
+
+}
+
+// delivers the results as soon as the devices report the end of conversion
+// (externally powered bus) or when the deadline is reached (parasite power)
+bool DallasTemperature::processConversion(void){
+
+    if (!conversionPending) return false;
+
+    if (millisToConversionDeadline() > 0 && (parasite || !isConversionComplete())) return false;
+
+    conversionPending = false;
+
+    if (deviceTable != NULL){
+
+        bool missing = false;
+
+        for (uint8_t i = 0; i < devices; i++){
+            int16_t raw = getTemp(deviceTable[i]);
+            if (raw == DEVICE_DISCONNECTED_RAW) missing = true;
+            if (_temperatureHandler != NULL) _temperatureHandler(deviceTable[i], raw);
+        }
+
+        // a device did not answer: the table will be rebuilt for the next conversion
+        if (missing) discoverDevices();
+
+        return true;
+    }
+
+    DeviceAddress deviceAddress;
+    _wire->reset_search();
+
+    while (_wire->search(deviceAddress)){
+        if (validAddress(deviceAddress) && _temperatureHandler != NULL){
+            _temperatureHandler(deviceAddress, getTemp(deviceAddress));
+        }
+    }
+
+    return true;
+
+}
+
 // sends command for one device to perform a temp conversion by index
 bool DallasTemperature::requestTemperaturesByIndex(uint8_t deviceIndex){
 
@@ -509,6 +703,49 @@ float DallasTemperature::getTempC(const uint8_t* deviceAddress){
     return rawToCelsius(getTemp(deviceAddress));
 }
 
+// returns temperature in hundredths of degrees C or DEVICE_DISCONNECTED_CENTI
+// if the device's scratch pad cannot be read successfully.
+int16_t DallasTemperature::getTempCenti(const uint8_t* deviceAddress){
+    return rawToCentiCelsius(getTemp(deviceAddress));
+}
+
+// reads every device of the table one after the other, each scratchpad is
+// checked with its crc and its configuration gives the conversion time
+// a pending asynchronous conversion is considered delivered
+uint8_t DallasTemperature::readTemperatures(TemperatureReading* readings){
+
+    ScratchPad scratchPad;
+    uint8_t valid = 0;
+
+    conversionPending = false;
+
+    if (deviceTable == NULL) return 0;
+
+    for (uint8_t i = 0; i < devices; i++){
+
+        if (isConnected(deviceTable[i], scratchPad)){
+            readings[i].centiCelsius = rawToCentiCelsius(calculateTemperature(deviceTable[i], scratchPad));
+
+            uint8_t resolution = 12;
+            if (deviceTable[i][0] != DS18S20MODEL){
+                resolution = 9 + ((scratchPad[CONFIGURATION] >> 5) & 0x03);
+            }
+            readings[i].conversionMillis = millisToWaitForConversion(resolution);
+
+            valid++;
+        } else {
+            readings[i].centiCelsius = DEVICE_DISCONNECTED_CENTI;
+            readings[i].conversionMillis = 0;
+        }
+    }
+
+    // a device did not answer: the table will be rebuilt for the next conversion
+    if (valid < devices) discoverDevices();
+
+    return valid;
+
+}
+
 // returns temperature in degrees F or DEVICE_DISCONNECTED_F if the
 // device's scratch pad cannot be read successfully.
 // the numeric value of DEVICE_DISCONNECTED_F is defined in
@@ -591,6 +828,16 @@ float DallasTemperature::rawToCelsius(int16_t raw){
 
 }
 
+// convert from raw to hundredths of degrees C without float
+int16_t DallasTemperature::rawToCentiCelsius(int16_t raw){
+
+    if (raw <= DEVICE_DISCONNECTED_RAW)
+    return DEVICE_DISCONNECTED_CENTI;
+    // C = RAW/128, rounded to nearest
+    return ((int32_t)raw * 100 + (raw < 0 ? -64 : 64)) / 128;
+
+}
+
 // convert from raw to Fahrenheit
 float DallasTemperature::rawToFahrenheit(int16_t raw){
 
@@ -28,13 +28,22 @@
 #define DS1825MODEL  0x3B
 #define DS28EA00MODEL 0x42
 
+// Size of the device table stored in EEPROM: count, addresses and crc
+#define DEVICE_TABLE_EEPROM_SIZE(devices) (2 + 8 * (devices))
+
 // Error Codes
 #define DEVICE_DISCONNECTED_C -127
 #define DEVICE_DISCONNECTED_F -196.6
 #define DEVICE_DISCONNECTED_RAW -7040
+#define DEVICE_DISCONNECTED_CENTI -12700
 
 typedef uint8_t DeviceAddress[8];
 
+struct TemperatureReading {
+    int16_t centiCelsius;      // DEVICE_DISCONNECTED_CENTI when the scratchpad is invalid
+    uint16_t conversionMillis; // conversion time for the device resolution
+};
+
 class DallasTemperature
 {
 public:
@@ -47,6 +56,13 @@ public:
     // initialise bus
     void begin(void);
 
+    // initialise bus from the device table stored in EEPROM, the bus is only
+    // searched when the stored table is invalid or a device does not answer
+    uint8_t begin(int, DeviceAddress*, uint8_t);
+
+    // searches the bus to fill the device table and saves it in EEPROM
+    uint8_t discoverDevices(void);
+
     // returns the number of devices found on the bus
     uint8_t getDeviceCount(void);
 
@@ -110,6 +126,12 @@ public:
     // returns temperature in degrees C
     float getTempC(const uint8_t*);
 
+    // returns temperature in hundredths of degrees C
+    int16_t getTempCenti(const uint8_t*);
+
+    // reads the scratchpad of every device of the table, returns the number of valid readings
+    uint8_t readTemperatures(TemperatureReading*);
+
     // returns temperature in degrees F
     float getTempF(const uint8_t*);
 
@@ -127,6 +149,22 @@ public:
 
     int16_t millisToWaitForConversion(uint8_t);
 
+    typedef void TemperatureHandler(const uint8_t*, int16_t);
+
+    // sends command for all devices on the bus to perform a temperature conversion
+    // and returns immediately, results are delivered by processConversion()
+    void requestTemperaturesAsync(TemperatureHandler*);
+
+    // returns true while a conversion started by requestTemperaturesAsync() is not delivered
+    bool isConversionPending(void);
+
+    // returns the number of milliseconds left before the conversion deadline
+    uint16_t millisToConversionDeadline(void);
+
+    // calls the handler with the raw temperature of each device once the conversion
+    // is complete, returns true when the results have been delivered
+    bool processConversion(void);
+
 #if REQUIRESALARMS
 
     typedef void AlarmHandler(const uint8_t*);
@@ -192,6 +230,9 @@ public:
     // convert from raw to Fahrenheit
     static float rawToFahrenheit(int16_t);
 
+    // convert from raw to hundredths of degrees C
+    static int16_t rawToCentiCelsius(int16_t);
+
 #if REQUIRESNEW
 
     // initialize memory area
@@ -224,6 +265,19 @@ private:
     // Take a pointer to one wire instance
     OneWire* _wire;
 
+    // known device addresses, NULL when the bus is searched each time
+    DeviceAddress* deviceTable;
+    uint8_t deviceTableSize;
+    int deviceTableEeprom;
+
+    uint8_t loadDeviceTable(void);
+    void saveDeviceTable(void);
+
+    // asynchronous conversion state
+    bool conversionPending;
+    unsigned long conversionStart;
+    TemperatureHandler *_temperatureHandler;
+
     // reads scratchpad and returns the raw temperature
     int16_t calculateTemperature(const uint8_t*, uint8_t*);
 
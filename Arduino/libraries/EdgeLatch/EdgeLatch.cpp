@@ -0,0 +1,104 @@
+#include "EdgeLatch.h"
+
+EdgeLatch::EdgeLatch(uint8_t pin) {
+  _pin = pin;
+  _bit = digitalPinToBitMask(pin);
+  _inputRegister = portInputRegister(digitalPinToPort(pin));
+  _pending = false;
+  _guard = false;
+  resetLatency();
+}
+
+void EdgeLatch::begin() {
+  noInterrupts();
+  // the current state is the first event to send
+  _state = (*_inputRegister & _bit) ? HIGH : LOW;
+  _edgeTime = millis();
+  _pending = true;
+
+  *digitalPinToPCMSK(_pin) |= _BV(digitalPinToPCMSKbit(_pin));
+  PCIFR |= _BV(digitalPinToPCICRbit(_pin)); // clear pending interrupt
+  *digitalPinToPCICR(_pin) |= _BV(digitalPinToPCICRbit(_pin));
+  interrupts();
+}
+
+// Runs right after the wake up, before the sketch does anything else.
+// millis() is frozen while sleeping but is accurate from here on.
+void EdgeLatch::handleInterrupt() {
+  uint8_t state = (*_inputRegister & _bit) ? HIGH : LOW;
+
+  // other pins of the same port share the vector
+  if (state == _state) {
+    return;
+  }
+
+  if (!_pending) {
+    _edgeTime = millis();
+  }
+
+  _state = state;
+  _pending = true;
+}
+
+bool EdgeLatch::available() {
+  return _pending;
+}
+
+// returns the latched state and starts timing its delivery
+uint8_t EdgeLatch::read() {
+  noInterrupts();
+  uint8_t state = _state;
+  _readEdgeTime = _edgeTime;
+  _pending = false;
+  interrupts();
+
+  _guard = true;
+
+  return state;
+}
+
+void EdgeLatch::acknowledged() {
+  _lastLatency = min(millis() - _readEdgeTime, 0xFFFFUL);
+  _maxLatency = max(_maxLatency, _lastLatency);
+  _latencySum += _lastLatency;
+
+  if (_count < 0xFFFF) {
+    _count++;
+  }
+}
+
+// Sleep time to use for a sleep of ms. An edge latched after available() but
+// before sleep() powers down does not wake the node: the first sleep after a
+// read, while the contact may still move, is bounded so such an edge waits
+// EDGE_LATCH_GUARD at most.
+unsigned long EdgeLatch::sleepTime(unsigned long ms) {
+  if (_guard) {
+    _guard = false;
+    return min(ms, EDGE_LATCH_GUARD);
+  }
+
+  return ms;
+}
+
+uint16_t EdgeLatch::getLastLatency() {
+  return _lastLatency;
+}
+
+uint16_t EdgeLatch::getMaxLatency() {
+  return _maxLatency;
+}
+
+uint16_t EdgeLatch::getAverageLatency() {
+  return _count == 0 ? 0 : _latencySum / _count;
+}
+
+uint16_t EdgeLatch::getCount() {
+  return _count;
+}
+
+void EdgeLatch::resetLatency() {
+  _lastLatency = 0;
+  _maxLatency = 0;
+  _count = 0;
+  _latencySum = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef EdgeLatch_h
+#define EdgeLatch_h
+
+#include "Arduino.h"
+
+#define EDGE_LATCH_GUARD 1000UL  // ms, first sleep after a value was read
+
+// Latches the state of an input on its pin change interrupt, so the value
+// sent is the one that woke the node, and measures the delay from the edge
+// to its acknowledgement.
+// The sketch forwards the PCINTx_vect of the pin to handleInterrupt().
+class EdgeLatch
+{
+  public:
+    EdgeLatch(uint8_t pin);
+    void begin();
+    void handleInterrupt();
+    bool available();
+    uint8_t read();
+    void acknowledged();
+    unsigned long sleepTime(unsigned long ms);
+    uint16_t getLastLatency();
+    uint16_t getMaxLatency();
+    uint16_t getAverageLatency();
+    uint16_t getCount();
+    void resetLatency();
+
+  private:
+    uint8_t _pin;
+    uint8_t _bit;
+    volatile uint8_t *_inputRegister;
+    volatile uint8_t _state;
+    volatile bool _pending;
+    bool _guard;
+    volatile unsigned long _edgeTime;   // first edge not read yet
+    unsigned long _readEdgeTime;        // edge of the last value read
+    uint16_t _lastLatency;
+    uint16_t _maxLatency;
+    uint16_t _count;
+    uint32_t _latencySum;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "EventCoalescer.h"
+
+EventCoalescer::EventCoalescer(unsigned long window) {
+  _window = window;
+  _sleepOffset = 0;
+  _count = 0;
+  _open = false;
+}
+
+// returns true when the edge opens a burst and must be sent now
+bool EventCoalescer::event(uint8_t state) {
+  unsigned long time = now();
+
+  if (_open && _count == 0 && time - _firstTime >= _window) {
+    _open = false;
+  }
+
+  if (!_open) {
+    _open = true;
+    _firstTime = time;
+    _lastTime = time;
+    _state = state;
+    _count = 0;
+    return true;
+  }
+
+  // folded even if the window is over, the summary has not been sent yet
+  _lastTime = time;
+  _state = state;
+
+  if (_count < 0xFFFF) {
+    _count++;
+  }
+
+  return false;
+}
+
+bool EventCoalescer::summaryDue() {
+  return _open && _count > 0 && now() - _firstTime >= _window;
+}
+
+void EventCoalescer::summarySent() {
+  _open = false;
+  _count = 0;
+}
+
+// milliseconds until the summary is due, EVENT_NO_SUMMARY if nothing was folded
+unsigned long EventCoalescer::timeToSummary() {
+  if (!_open || _count == 0) {
+    return EVENT_NO_SUMMARY;
+  }
+
+  unsigned long elapsed = now() - _firstTime;
+
+  return elapsed >= _window ? 0 : _window - elapsed;
+}
+
+void EventCoalescer::slept(unsigned long ms) {
+  _sleepOffset += ms;
+}
+
+uint8_t EventCoalescer::getState() {
+  return _state;
+}
+
+uint16_t EventCoalescer::getCount() {
+  return _count;
+}
+
+unsigned long EventCoalescer::getDuration() {
+  return _lastTime - _firstTime;
+}
+
+unsigned long EventCoalescer::now() {
+  return millis() + _sleepOffset;
+}
@@ -0,0 +1,35 @@
+#ifndef EventCoalescer_h
+#define EventCoalescer_h
+
+#include "Arduino.h"
+
+#define EVENT_NO_SUMMARY 0xFFFFFFFFUL
+
+// The first edge of a burst is sent at once, the following ones within the
+// window are folded into a summary: final state, count and duration.
+class EventCoalescer
+{
+  public:
+    EventCoalescer(unsigned long window);
+    bool event(uint8_t state);
+    bool summaryDue();
+    void summarySent();
+    unsigned long timeToSummary();
+    void slept(unsigned long ms);
+    uint8_t getState();
+    uint16_t getCount();
+    unsigned long getDuration();
+
+  private:
+    unsigned long now();
+
+    unsigned long _window;
+    unsigned long _sleepOffset;  // millis() does not run while sleeping
+    unsigned long _firstTime;
+    unsigned long _lastTime;
+    uint16_t _count;             // edges folded since the first one
+    uint8_t _state;
+    bool _open;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef FastPin_h
+#define FastPin_h
+
+#include "Arduino.h"
+
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+// pin change banks follow the ports: 0 is port B, 1 port C and 2 port D
+constexpr uint8_t fastPinBank(uint8_t pin) { return pin < 8 ? 2 : (pin < 14 ? 0 : 1); }
+constexpr uint8_t fastPinBit(uint8_t pin) { return pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14); }
+
+// checked against the board variant for every digital pin
+constexpr bool fastPinMatchesVariant(uint8_t pin) {
+  return pin == 20 || (fastPinBank(pin) == digitalPinToPCICRbit(pin) &&
+                       fastPinBit(pin) == digitalPinToPCMSKbit(pin) && fastPinMatchesVariant(pin + 1));
+}
+
+static_assert(fastPinMatchesVariant(0), "FastPin: the board variant maps D0-D19 to other ports");
+#endif
+
+// Digital pin with its port and bit resolved at compile time: on the ATmega328P
+// boards (Pro Mini, Nano) a write is a single SBI/CBI and a read a single test of
+// the PIN register. D0-D7 are on port D, D8-D13 on port B and A0-A5 (14-19) on
+// port C, A6 and A7 are analog only.
+// Unlike digitalWrite(), a write does not turn off the PWM of the pin.
+template<uint8_t PIN>
+class FastPin
+{
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+    static_assert(PIN < 20, "FastPin: not a digital pin of an ATmega328P");
+
+    static const uint8_t BIT = _BV(fastPinBit(PIN));
+
+  public:
+    static inline void output() __attribute__((always_inline)) {
+      if (PIN < 8) DDRD |= BIT; else if (PIN < 14) DDRB |= BIT; else DDRC |= BIT;
+    }
+
+    static inline void input() __attribute__((always_inline)) {
+      if (PIN < 8) DDRD &= ~BIT; else if (PIN < 14) DDRB &= ~BIT; else DDRC &= ~BIT;
+      low();
+    }
+
+    static inline void inputPullup() __attribute__((always_inline)) {
+      if (PIN < 8) DDRD &= ~BIT; else if (PIN < 14) DDRB &= ~BIT; else DDRC &= ~BIT;
+      high();
+    }
+
+    static inline void high() __attribute__((always_inline)) {
+      if (PIN < 8) PORTD |= BIT; else if (PIN < 14) PORTB |= BIT; else PORTC |= BIT;
+    }
+
+    static inline void low() __attribute__((always_inline)) {
+      if (PIN < 8) PORTD &= ~BIT; else if (PIN < 14) PORTB &= ~BIT; else PORTC &= ~BIT;
+    }
+
+    // writing a one to the PIN register toggles the output
+    static inline void toggle() __attribute__((always_inline)) {
+      if (PIN < 8) PIND = BIT; else if (PIN < 14) PINB = BIT; else PINC = BIT;
+    }
+
+    static inline bool read() __attribute__((always_inline)) {
+      if (PIN < 8) return PIND & BIT; else if (PIN < 14) return PINB & BIT; else return PINC & BIT;
+    }
+#else
+  public:
+    static inline void output() { pinMode(PIN, OUTPUT); }
+    static inline void input() { pinMode(PIN, INPUT); }
+    static inline void inputPullup() { pinMode(PIN, INPUT_PULLUP); }
+    static inline void high() { digitalWrite(PIN, HIGH); }
+    static inline void low() { digitalWrite(PIN, LOW); }
+    static inline void toggle() { digitalWrite(PIN, !digitalRead(PIN)); }
+    static inline bool read() { return digitalRead(PIN); }
+#endif
+
+    static inline void write(bool value) __attribute__((always_inline)) {
+      if (value) high(); else low();
+    }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "KeypadScanner.h"
+
+KeypadScanner::KeypadScanner(const char *keys, const byte *rowPins, const byte *colPins, byte rows, byte cols) {
+  _keys = keys;
+  _rowPins = rowPins;
+  _rows = min(rows, KEYPAD_MAX_ROWS);
+  _cols = min(cols, KEYPAD_MAX_COLS);
+
+  for (byte r = 0; r < _rows; r++) {
+    _rowInput[r] = portInputRegister(digitalPinToPort(rowPins[r]));
+    _rowBit[r] = digitalPinToBitMask(rowPins[r]);
+  }
+
+  for (byte c = 0; c < _cols; c++) {
+    _colMode[c] = portModeRegister(digitalPinToPort(colPins[c]));
+    _colOutput[c] = portOutputRegister(digitalPinToPort(colPins[c]));
+    _colBit[c] = digitalPinToBitMask(colPins[c]);
+  }
+
+  _raw = 0;
+  _state = 0;
+  _pending = 0;
+  _rawTime = 0;
+}
+
+void KeypadScanner::begin() {
+  for (byte r = 0; r < _rows; r++) {
+    pinMode(_rowPins[r], INPUT_PULLUP);
+  }
+
+  scan();
+}
+
+// A press is returned on its first scan, a release needs KEYPAD_DEBOUNCE_MS
+// without change so the bounces of the contact are not new presses
+char KeypadScanner::getKey() {
+  uint16_t raw = scan();
+
+  if (raw != _raw) {
+    _raw = raw;
+    _rawTime = millis();
+  }
+
+  uint16_t pressed = raw & ~_state;
+  _state |= pressed;
+  _pending |= pressed;
+
+  if (millis() - _rawTime >= KEYPAD_DEBOUNCE_MS) {
+    _state &= raw;
+  }
+
+  if (_pending == 0) {
+    return KEYPAD_NO_KEY;
+  }
+
+  byte index = 0;
+  while (!(_pending & (1U << index))) {
+    index++;
+  }
+
+  _pending &= ~(1U << index);
+  return _keys[index];
+}
+
+bool KeypadScanner::isIdle() {
+  return _state == 0 && _pending == 0 && scan() == 0;
+}
+
+void KeypadScanner::prepareSleep() {
+  setPinChangeInterrupt(true);
+}
+
+// Only wakes the MCU: the scan itself toggles the rows
+void KeypadScanner::handleInterrupt() {
+  setPinChangeInterrupt(false);
+}
+
+uint16_t KeypadScanner::scan() {
+  uint16_t keys = 0;
+
+  for (byte c = 0; c < _cols; c++) {
+    noInterrupts();
+    for (byte i = 0; i < _cols; i++) {
+      if (i == c) {
+        *_colOutput[i] &= ~_colBit[i];
+        *_colMode[i] |= _colBit[i];
+      } else {
+        *_colMode[i] &= ~_colBit[i];
+        *_colOutput[i] |= _colBit[i];
+      }
+    }
+    interrupts();
+
+    delayMicroseconds(KEYPAD_SETTLE_US);
+
+    for (byte r = 0; r < _rows; r++) {
+      if (!(*_rowInput[r] & _rowBit[r])) {
+        keys |= 1U << (r * _cols + c);
+      }
+    }
+  }
+
+  // all the columns low between scans
+  noInterrupts();
+  for (byte c = 0; c < _cols; c++) {
+    *_colOutput[c] &= ~_colBit[c];
+    *_colMode[c] |= _colBit[c];
+  }
+  interrupts();
+
+  return keys;
+}
+
+void KeypadScanner::setPinChangeInterrupt(bool enable) {
+  for (byte r = 0; r < _rows; r++) {
+    byte pin = _rowPins[r];
+
+    if (enable) {
+      *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+      PCIFR |= _BV(digitalPinToPCICRbit(pin)); // clear pending interrupt
+      *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+    } else {
+      *digitalPinToPCMSK(pin) &= ~_BV(digitalPinToPCMSKbit(pin));
+    }
+  }
+}
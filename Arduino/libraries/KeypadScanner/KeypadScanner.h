@@ -0,0 +1,45 @@
+#ifndef KeypadScanner_h
+#define KeypadScanner_h
+
+#include "Arduino.h"
+
+#define KEYPAD_MAX_ROWS 4
+#define KEYPAD_MAX_COLS 4
+#define KEYPAD_NO_KEY '\0'
+#define KEYPAD_DEBOUNCE_MS 20   // a key is released after this delay without change
+#define KEYPAD_SETTLE_US 5      // row pull-ups rising time after a column switch
+
+// Scans a key matrix with the port registers. Columns are driven low one at a
+// time and rows are inputs with pull-ups. Between scans all the columns stay low,
+// so a key press pulls its row low and the row pin change interrupt wakes the MCU.
+// The sketch forwards the PCINTx_vect of the row pins to handleInterrupt().
+class KeypadScanner
+{
+  public:
+    KeypadScanner(const char *keys, const byte *rowPins, const byte *colPins, byte rows, byte cols);
+    void begin();
+    char getKey();
+    bool isIdle();
+    void prepareSleep();
+    void handleInterrupt();
+
+  private:
+    uint16_t scan();
+    void setPinChangeInterrupt(bool enable);
+
+    const char *_keys;          // rows x cols
+    const byte *_rowPins;
+    byte _rows;
+    byte _cols;
+    volatile uint8_t *_rowInput[KEYPAD_MAX_ROWS];
+    byte _rowBit[KEYPAD_MAX_ROWS];
+    volatile uint8_t *_colMode[KEYPAD_MAX_COLS];
+    volatile uint8_t *_colOutput[KEYPAD_MAX_COLS];
+    byte _colBit[KEYPAD_MAX_COLS];
+    uint16_t _raw;              // one bit per key, row * cols + col
+    uint16_t _state;
+    uint16_t _pending;          // pressed, not returned by getKey() yet
+    unsigned long _rawTime;
+};
+
+#endif
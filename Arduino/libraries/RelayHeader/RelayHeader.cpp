@@ -0,0 +1,57 @@
+#include "RelayHeader.h"
+
+bool parseRelayHeader(const char* message, RelayHeader* header)
+{
+  byte fields[RELAY_HEADER_FIELDS];
+  byte field = 0;
+  int value = 0;
+  bool hasDigit = false;
+  byte i = 0;
+
+  if (message == NULL) {
+    return false;
+  }
+
+  // decode the numeric fields in a single pass, stop on the 5th separator
+  for (; i < RELAY_MAX_MESSAGE_SIZE && message[i] != 0; ++i) {
+    char c = message[i];
+
+    if (c >= '0' && c <= '9') {
+      value = value * 10 + (c - '0');
+
+      if (value > 255) {
+        return false;
+      }
+
+      hasDigit = true;
+    } else if (c == '-' && hasDigit) {
+      fields[field++] = value;
+      value = 0;
+      hasDigit = false;
+
+      if (field == RELAY_HEADER_FIELDS) {
+        break;
+      }
+    } else {
+      return false;
+    }
+  }
+
+  // payload must follow the 5th separator and not be empty
+  if (field != RELAY_HEADER_FIELDS || i + 1 >= RELAY_MAX_MESSAGE_SIZE || message[i + 1] == 0) {
+    return false;
+  }
+
+  if (fields[3] > 1) {
+    return false;
+  }
+
+  header->destination = fields[0];
+  header->sensor = fields[1];
+  header->command = fields[2];
+  header->requestAck = fields[3] == 1;
+  header->type = fields[4];
+  header->payload = message + i + 1;
+
+  return true;
+}
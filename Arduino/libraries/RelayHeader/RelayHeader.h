@@ -0,0 +1,21 @@
+#ifndef RelayHeader_h
+#define RelayHeader_h
+
+#include "Arduino.h"
+
+#define RELAY_HEADER_FIELDS 5
+#define RELAY_MAX_MESSAGE_SIZE 25 // maximum MySensors payload size is 25 bytes
+
+// message format: destination-sensor-command-ack-type-payload
+struct RelayHeader {
+  byte destination;
+  byte sensor;
+  byte command;
+  bool requestAck;
+  byte type;
+  const char* payload;
+};
+
+bool parseRelayHeader(const char* message, RelayHeader* header);
+
+#endif
@@ -0,0 +1,10 @@
+// Host stand-in for the few Arduino definitions RelayHeader uses
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t byte;
+
+#endif
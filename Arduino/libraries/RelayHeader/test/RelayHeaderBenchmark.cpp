@@ -0,0 +1,110 @@
+// Host benchmark of parseRelayHeader() against the getMessagePart()/getPayload()
+// pair GatewayMySensors used before, on the same valid messages:
+//   g++ -std=c++11 -O2 -I. -I.. RelayHeaderBenchmark.cpp ../RelayHeader.cpp -o RelayHeaderBenchmark
+//   ./RelayHeaderBenchmark
+// The host only gives the ratio, the old pair rescans the message for every
+// field and calls strlen() on each character on the AVR as well.
+
+#include "RelayHeader.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// previous gateway code, unchanged except for the const cast
+static int getMessagePart(const char* message, const byte index) {
+  byte indexCount = 0;
+
+  if (index == 0 && strlen(message) > 0) {
+    return atoi(message);
+  }
+
+  for (byte i=0; i < strlen(message) - 1; i++) {
+    if (message[i] == '-') {
+      indexCount++;
+    }
+
+    if (indexCount == index) {
+      return atoi(message + i + 1);
+    }
+  }
+
+  return 0;
+}
+
+static char* getPayload(const char* message) {
+  byte indexCount = 0;
+
+  for (byte i=0; i < strlen(message) - 1; i++) {
+    if (message[i] == '-') {
+      indexCount++;
+    }
+
+    if (indexCount == 5) {
+      return (char*)message + i + 1;
+    }
+  }
+
+  return NULL;
+}
+
+static const char* MESSAGES[] = {
+  "0-1-1-0-2-1",
+  "12-3-1-1-47-hello",
+  "255-255-255-1-255-0123456",
+  "5-0-1-0-16-on",
+};
+static const int MESSAGE_COUNT = sizeof(MESSAGES) / sizeof(MESSAGES[0]);
+static const long RUNS = 2000000;
+
+volatile unsigned long sink;
+
+// the six calls relayMessage() made for one message
+static void parseOld(const char* message) {
+  if (getPayload(message) != NULL) {
+    sink += getMessagePart(message, 0) + getMessagePart(message, 1) + getMessagePart(message, 2) +
+            getMessagePart(message, 3) + getMessagePart(message, 4) + *getPayload(message);
+  }
+}
+
+static void parseNew(const char* message) {
+  RelayHeader header;
+
+  if (parseRelayHeader(message, &header)) {
+    sink += header.destination + header.sensor + header.command + header.requestAck + header.type +
+            *header.payload;
+  }
+}
+
+static double nanosPerMessage(void (*parse)(const char*)) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for (long run = 0; run < RUNS; run++) {
+    parse(MESSAGES[run % MESSAGE_COUNT]);
+  }
+
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / RUNS;
+}
+
+int main() {
+  // both decode the same fields
+  for (int i = 0; i < MESSAGE_COUNT; i++) {
+    RelayHeader header;
+
+    if (!parseRelayHeader(MESSAGES[i], &header) || header.destination != getMessagePart(MESSAGES[i], 0) ||
+        header.type != getMessagePart(MESSAGES[i], 4) || header.payload != getPayload(MESSAGES[i])) {
+      printf("FAIL %s\n", MESSAGES[i]);
+      return 1;
+    }
+  }
+
+  double oldNanos = nanosPerMessage(parseOld);
+  double newNanos = nanosPerMessage(parseNew);
+
+  printf("getMessagePart/getPayload %8.1f ns/message\n", oldNanos);
+  printf("parseRelayHeader          %8.1f ns/message\n", newNanos);
+  printf("speedup                   %8.1fx\n", oldNanos / newNanos);
+  return 0;
+}
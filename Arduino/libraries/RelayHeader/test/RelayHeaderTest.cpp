@@ -0,0 +1,139 @@
+// Host test of parseRelayHeader() on valid, truncated and random buffers.
+// Every buffer is allocated to its exact size so the sanitizer reports any
+// read past it:
+//   g++ -std=c++11 -fsanitize=address,undefined -I. -I.. RelayHeaderTest.cpp ../RelayHeader.cpp -o RelayHeaderTest
+//   ./RelayHeaderTest
+
+#include "RelayHeader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition, message) \
+  if (!(condition)) { \
+    printf("FAIL %s: %s\n", #condition, message); \
+    failures++; \
+  }
+
+// parse a copy of length bytes and check the result stays inside it, only a
+// buffer of RELAY_MAX_MESSAGE_SIZE can come without terminator
+static bool parse(const char* source, size_t length, bool terminated, RelayHeader* header) {
+  char* buffer = (char*)malloc(length + (terminated ? 1 : 0));
+  memcpy(buffer, source, length);
+
+  if (terminated) {
+    buffer[length] = 0;
+  }
+
+  memset(header, 0, sizeof(*header));
+  bool valid = parseRelayHeader(buffer, header);
+
+  if (valid) {
+    size_t offset = header->payload - buffer;
+    CHECK(header->payload > buffer && offset < length, source);
+    CHECK(offset < RELAY_MAX_MESSAGE_SIZE, source);
+    CHECK(header->payload[-1] == '-' && header->payload[0] != 0, source);
+  }
+
+  free(buffer);
+  return valid;
+}
+
+static void testValid() {
+  RelayHeader header;
+  const char* message = "12-3-1-1-47-hello";
+
+  CHECK(parse(message, strlen(message), true, &header), message);
+  CHECK(header.destination == 12 && header.sensor == 3 && header.command == 1, message);
+  CHECK(header.requestAck && header.type == 47, message);
+
+  CHECK(!parse("256-3-1-1-47-x", 14, true, &header), "field above 255");
+  CHECK(!parse("1-3-1-2-47-x", 12, true, &header), "ack above 1");
+  CHECK(!parse("1--1-1-47-x", 11, true, &header), "empty field");
+  CHECK(!parse("1-3-1-1-47-", 11, true, &header), "empty payload");
+  CHECK(!parse("1-3-a-1-47-x", 12, true, &header), "not a digit");
+}
+
+// every prefix of a valid message is only accepted once it holds the payload
+static void testTruncated() {
+  const char* message = "255-255-255-1-255-0123456";
+  size_t length = strlen(message);
+  size_t payload = strchr(message, '0') - message;
+  RelayHeader header;
+
+  CHECK(length == RELAY_MAX_MESSAGE_SIZE, "message fills the payload");
+
+  for (size_t i = 0; i <= length; i++) {
+    CHECK(parse(message, i, true, &header) == (i > payload), "prefix");
+  }
+
+  // a full payload buffer needs no terminator
+  CHECK(parse(message, length, false, &header), "unterminated payload");
+}
+
+// a header of random fields, often out of range, and a random payload
+static size_t randomMessage(char* source, size_t size) {
+  size_t length = 0;
+
+  for (byte field = 0; field < RELAY_HEADER_FIELDS; field++) {
+    length += snprintf(source + length, size - length, "%d-", rand() % (field == 3 ? 3 : 300));
+  }
+
+  size_t payload = rand() % (size - length);
+
+  for (size_t i = 0; i < payload; i++) {
+    source[length++] = (char)(rand() % 255 + 1);
+  }
+
+  return length;
+}
+
+static void testRandom() {
+  char source[RELAY_MAX_MESSAGE_SIZE * 2];
+  RelayHeader header;
+  long accepted = 0;
+  srand(1);
+
+  for (long run = 0; run < 200000; run++) {
+    size_t length;
+
+    if (run % 2) {
+      length = rand() % sizeof(source);
+
+      for (size_t i = 0; i < length; i++) {
+        source[i] = (char)(rand() % 255 + 1);
+      }
+    } else {
+      length = randomMessage(source, sizeof(source));
+      // then one random byte and a random truncation
+      source[rand() % length] = (char)(rand() % 255 + 1);
+      length = rand() % (length + 1);
+    }
+
+    if (parse(source, length, true, &header)) {
+      accepted++;
+    }
+
+    if (length >= RELAY_MAX_MESSAGE_SIZE) {
+      // the parser never looks past the largest payload
+      parse(source, RELAY_MAX_MESSAGE_SIZE, false, &header);
+    }
+  }
+
+  CHECK(accepted > 1000, "random messages reach the payload");
+}
+
+int main() {
+  RelayHeader header;
+  CHECK(!parseRelayHeader(NULL, &header), "null message");
+
+  testValid();
+  testTruncated();
+  testRandom();
+
+  printf("%s\n", failures == 0 ? "ok" : "failed");
+  return failures == 0 ? 0 : 1;
+}
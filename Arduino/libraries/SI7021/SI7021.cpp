@@ -11,6 +11,7 @@ This program is licensed under the GNU GPL v2
 
 // I2C commands
 byte RH_READ[]           = { 0xE5 };
+byte RH_READ_NO_HOLD[]   = { 0xF5 };
 byte TEMP_READ[]         = { 0xE3 };
 byte POST_RH_TEMP_READ[] = { 0xE0 };
 byte RESET[]             = { 0xFE };
@@ -133,3 +134,42 @@ struct si7021_env SI7021::getHumidityAndTemperature() {
     ret.fahrenheitHundredths     = (1.8 * ret.celsiusHundredths) + 3200;
     return ret;
 }
+
+// start a RH conversion in no hold master mode, the bus and the MCU are free
+// until readConversion(), at most SI7021_CONVERSION_MS later
+bool SI7021::startConversion() {
+    Wire.beginTransmission(I2C_ADDR);
+    Wire.write(RH_READ_NO_HOLD[0]);
+    return Wire.endTransmission() == 0;
+}
+
+// read the humidity and the temperature measured with it, the sensor
+// NACKs its address while the conversion is still running
+bool SI7021::readConversion(struct si7021_env * env) {
+    unsigned long start = millis();
+    while (Wire.requestFrom((uint8_t)I2C_ADDR, (uint8_t)2) < 2) {
+        if (millis() - start > SI7021_CONVERSION_MS) {
+            return false;
+        }
+        delay(1);
+    }
+    long humraw = (long)Wire.read() << 8;
+    humraw |= Wire.read();
+
+    long basisPoints = ((12500 * humraw) >> 16) - 600;
+    env->humidityBasisPoints  = constrain(basisPoints, 0, 10000);
+    env->humidityPercent      = (env->humidityBasisPoints + 50) / 100;
+
+    // one command byte: _command() sends sizeof a pointer
+    Wire.beginTransmission(I2C_ADDR);
+    Wire.write(POST_RH_TEMP_READ[0]);
+    if (Wire.endTransmission() != 0 || Wire.requestFrom((uint8_t)I2C_ADDR, (uint8_t)2) < 2) {
+        return false;
+    }
+    long tempraw = (long)Wire.read() << 8;
+    tempraw |= Wire.read();
+
+    env->celsiusHundredths    = ((17572 * tempraw) >> 16) - 4685;
+    env->fahrenheitHundredths = (long)env->celsiusHundredths * 9 / 5 + 3200;
+    return true;
+}
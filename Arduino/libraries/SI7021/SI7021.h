@@ -20,10 +20,14 @@ This program is licensed under the GNU GPL v2
  #include <Wire.h>
 #endif
 
+// Maximum duration of a 12 bit RH conversion followed by its 14 bit temperature
+#define SI7021_CONVERSION_MS 23
+
 typedef struct si7021_env {
     int celsiusHundredths;
     int fahrenheitHundredths;
     unsigned int humidityPercent;
+    unsigned int humidityBasisPoints;
 } si7021_env;
 
 class SI7021
@@ -37,6 +41,8 @@ class SI7021
     unsigned int getHumidityPercent();
     unsigned int getHumidityBasisPoints();
     struct si7021_env getHumidityAndTemperature();
+    bool startConversion();
+    bool readConversion(struct si7021_env * env);
     int getSerialBytes(byte * buf);
     int getDeviceId();
     void setHeater(bool on);
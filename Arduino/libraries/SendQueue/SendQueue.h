@@ -0,0 +1,234 @@
+#ifndef SendQueue_h
+#define SendQueue_h
+
+// Header only: include after MySensors.h, the queue calls send() and wait()
+// with the radio configuration of the sketch.
+
+#include "Arduino.h"
+
+#ifndef SEND_QUEUE_SIZE
+#define SEND_QUEUE_SIZE 4
+#endif
+
+#define SEND_QUEUE_RETRIES 10
+#define SEND_QUEUE_ECHO_TIMEOUT 500UL  // wait for the echo of the destination node
+#define SEND_QUEUE_POLL 50UL           // maximum wait in flush() between two process()
+#define SEND_QUEUE_IDLE 0xFFFFFFFFUL
+
+struct SendQueueStats {
+  uint16_t sent;          // transmissions, retries included
+  uint16_t acked;
+  uint16_t failed;        // messages dropped after their last retry
+  uint16_t superseded;    // messages replaced by a newer value before being acked
+  uint16_t latencyMin;    // ms from first transmission to echo
+  uint16_t latencyMax;
+  uint32_t latencySum;
+};
+
+class SendQueue
+{
+  public:
+    SendQueue(uint16_t backoff = 500);
+    bool push(MyMessage &message, bool supersede = true, byte retries = SEND_QUEUE_RETRIES);
+    void process();
+    bool receive(const MyMessage &message);
+    bool flush();
+    bool isEmpty();
+    unsigned long timeToNext();
+    uint16_t getAverageLatency();
+    const SendQueueStats& getStats();
+    void resetStats();
+
+  private:
+    enum EntryState { FREE, READY, WAITING_ECHO };
+
+    struct Entry {
+      MyMessage message;
+      byte state;
+      byte attempts;
+      byte retries;
+      unsigned long firstSent;
+      unsigned long timer;  // echo deadline or next retry
+    };
+
+    void failed(Entry &entry, unsigned long now);
+
+    Entry _entries[SEND_QUEUE_SIZE];
+    uint16_t _backoff;
+    bool _lastFailed;
+    SendQueueStats _stats;
+};
+
+inline SendQueue::SendQueue(uint16_t backoff) {
+  _backoff = backoff;
+  _lastFailed = false;
+
+  for (byte i = 0; i < SEND_QUEUE_SIZE; i++) {
+    _entries[i].state = FREE;
+  }
+
+  resetStats();
+}
+
+// queue a copy of message, a queued message for the same child and type is
+// replaced when supersede is set: only the newest state matters
+inline bool SendQueue::push(MyMessage &message, bool supersede, byte retries) {
+  Entry *free = NULL;
+
+  for (byte i = 0; i < SEND_QUEUE_SIZE; i++) {
+    Entry &entry = _entries[i];
+
+    if (entry.state == FREE) {
+      if (free == NULL) {
+        free = &entry;
+      }
+    } else if (supersede && entry.message.destination == message.destination &&
+               entry.message.sensor == message.sensor && entry.message.type == message.type &&
+               entry.message.getCommand() == message.getCommand()) {
+      _stats.superseded++;
+      free = &entry;
+      break;
+    }
+  }
+
+  if (free == NULL) {
+    return false;
+  }
+
+  free->message = message;
+  free->state = READY;
+  free->attempts = 0;
+  free->retries = retries;
+  free->timer = millis();
+
+  return true;
+}
+
+// send due messages and handle missing echoes, call from loop()
+inline void SendQueue::process() {
+  for (byte i = 0; i < SEND_QUEUE_SIZE; i++) {
+    Entry &entry = _entries[i];
+    unsigned long now = millis();
+
+    if (entry.state == WAITING_ECHO && now - entry.timer >= SEND_QUEUE_ECHO_TIMEOUT) {
+      failed(entry, now);
+    } else if (entry.state == READY && (long)(now - entry.timer) >= 0) {
+      if (entry.attempts == 0) {
+        entry.firstSent = now;
+      }
+
+      entry.attempts++;
+      _stats.sent++;
+
+      if (send(entry.message, true)) {
+        entry.state = WAITING_ECHO;
+        entry.timer = millis();
+      } else {
+        failed(entry, millis());
+      }
+    }
+  }
+}
+
+inline void SendQueue::failed(Entry &entry, unsigned long now) {
+  if (entry.attempts > entry.retries) {
+    entry.state = FREE;
+    _stats.failed++;
+    _lastFailed = true;
+  } else {
+    entry.state = READY;
+    entry.timer = now + (unsigned long)_backoff * (entry.attempts - 1);
+  }
+}
+
+// forward every received message, returns true if it was the echo of a queued one
+inline bool SendQueue::receive(const MyMessage &message) {
+  if (!message.isAck()) {
+    return false;
+  }
+
+  for (byte i = 0; i < SEND_QUEUE_SIZE; i++) {
+    Entry &entry = _entries[i];
+
+    // the echo carries the payload, a superseded value cannot ack its replacement
+    if (entry.state == WAITING_ECHO && entry.message.sensor == message.sensor &&
+        entry.message.type == message.type && entry.message.getCommand() == message.getCommand() &&
+        mGetLength(entry.message) == mGetLength(message) &&
+        memcmp(entry.message.getCustom(), message.getCustom(), mGetLength(message)) == 0) {
+      unsigned long latency = min(millis() - entry.firstSent, 0xFFFFUL);
+
+      _stats.acked++;
+      _stats.latencySum += latency;
+      _stats.latencyMin = min(_stats.latencyMin, (uint16_t)latency);
+      _stats.latencyMax = max(_stats.latencyMax, (uint16_t)latency);
+
+      entry.state = FREE;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// process until every message is acked or dropped, returns false if one was dropped
+inline bool SendQueue::flush() {
+  _lastFailed = false;
+
+  while (!isEmpty()) {
+    process();
+    unsigned long next = timeToNext();
+    wait(min(next, SEND_QUEUE_POLL));
+  }
+
+  return !_lastFailed;
+}
+
+inline bool SendQueue::isEmpty() {
+  for (byte i = 0; i < SEND_QUEUE_SIZE; i++) {
+    if (_entries[i].state != FREE) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// milliseconds until process() has something to do
+inline unsigned long SendQueue::timeToNext() {
+  unsigned long next = SEND_QUEUE_IDLE;
+  unsigned long now = millis();
+
+  for (byte i = 0; i < SEND_QUEUE_SIZE; i++) {
+    Entry &entry = _entries[i];
+    unsigned long deadline = entry.timer;
+
+    if (entry.state == FREE) {
+      continue;
+    } else if (entry.state == WAITING_ECHO) {
+      deadline += SEND_QUEUE_ECHO_TIMEOUT;
+    }
+
+    if ((long)(deadline - now) <= 0) {
+      return 0;
+    }
+
+    next = min(next, deadline - now);
+  }
+
+  return next;
+}
+
+inline uint16_t SendQueue::getAverageLatency() {
+  return _stats.acked == 0 ? 0 : _stats.latencySum / _stats.acked;
+}
+
+inline const SendQueueStats& SendQueue::getStats() {
+  return _stats;
+}
+
+inline void SendQueue::resetStats() {
+  memset(&_stats, 0, sizeof(_stats));
+  _stats.latencyMin = 0xFFFF;
+}
+
+#endif
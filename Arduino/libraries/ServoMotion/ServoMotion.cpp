@@ -0,0 +1,229 @@
+#include "ServoMotion.h"
+
+ServoMotion::ServoMotion() {
+  _count = 0;
+  _callback = NULL;
+}
+
+byte ServoMotion::add(byte pin, byte powerPin, byte position) {
+  if (_count >= SERVO_MOTION_MAX) {
+    return SERVO_MOTION_MAX;
+  }
+
+  ServoAxis *axis = &_axes[_count];
+  axis->pin = pin;
+  axis->powerPin = powerPin;
+  axis->state = SERVO_IDLE;
+  axis->start = min(position, 180);
+  axis->target = axis->start;
+  axis->speed = 90;
+  axis->acceleration = 180;
+  axis->settle = 200;
+
+  if (powerPin != SERVO_NO_POWER_PIN) {
+    pinMode(powerPin, OUTPUT);
+    digitalWrite(powerPin, LOW);
+  }
+
+  return _count++;
+}
+
+void ServoMotion::setProfile(byte index, uint16_t speed, uint16_t acceleration, uint16_t settle) {
+  ServoAxis *axis = &_axes[index];
+  axis->speed = max(speed, 1);
+  axis->acceleration = acceleration;
+  axis->settle = settle;
+}
+
+void ServoMotion::onDone(ServoMotionCallback callback) {
+  _callback = callback;
+}
+
+// A new target while moving starts from the current position
+void ServoMotion::moveTo(byte index, byte position) {
+  ServoAxis *axis = &_axes[index];
+
+  // tick() leaves a settling servo alone while the move is planned
+  noInterrupts();
+  if (axis->state == SERVO_MOVING) {
+    axis->start = (axis->pulse - MIN_PULSE_WIDTH) * 180UL / (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH);
+    axis->state = SERVO_SETTLING;
+  } else {
+    axis->start = axis->target;
+  }
+  interrupts();
+
+  axis->target = min(position, 180);
+
+  plan(axis);
+
+  if (axis->state == SERVO_IDLE) {
+    if (axis->powerPin != SERVO_NO_POWER_PIN) {
+      digitalWrite(axis->powerPin, HIGH);
+    }
+
+    axis->state = SERVO_POWERING;
+    axis->startTime = millis();
+  } else if (axis->state != SERVO_POWERING) {
+    noInterrupts();
+    axis->startTime = millis();
+    axis->state = SERVO_MOVING;
+    interrupts();
+    setTick(true);
+  }
+}
+
+bool ServoMotion::isMoving(byte index) {
+  return _axes[index].state != SERVO_IDLE;
+}
+
+bool ServoMotion::isMoving() {
+  for (byte i = 0; i < _count; i++) {
+    if (isMoving(i)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Target once the move is over
+byte ServoMotion::getPosition(byte index) {
+  return _axes[index].target;
+}
+
+void ServoMotion::update() {
+  bool moving = false;
+
+  for (byte i = 0; i < _count; i++) {
+    ServoAxis *axis = &_axes[i];
+
+    switch (axis->state) {
+      case SERVO_POWERING:
+        if (millis() - axis->startTime >= SERVO_POWER_UP_MS) {
+          axis->pulse = toPulse(axis, 0);
+          axis->servo.attach(axis->pin);
+          axis->servo.writeMicroseconds(axis->pulse);
+
+          noInterrupts();
+          axis->startTime = millis();
+          axis->state = SERVO_MOVING;
+          interrupts();
+          moving = true;
+        }
+        break;
+
+      case SERVO_MOVING:
+        moving = true;
+        break;
+
+      case SERVO_SETTLING:
+        if (millis() - axis->startTime >= axis->settle) {
+          axis->servo.detach();
+
+          if (axis->powerPin != SERVO_NO_POWER_PIN) {
+            digitalWrite(axis->powerPin, LOW);
+          }
+
+          axis->state = SERVO_IDLE;
+
+          if (_callback != NULL) {
+            _callback(i, axis->target);
+          }
+        }
+        break;
+    }
+  }
+
+  setTick(moving);
+}
+
+void ServoMotion::tick() {
+  for (byte i = 0; i < _count; i++) {
+    ServoAxis *axis = &_axes[i];
+
+    if (axis->state != SERVO_MOVING) {
+      continue;
+    }
+
+    uint32_t time = millis() - axis->startTime;
+    uint32_t duration = 2 * axis->accelTime + axis->cruiseTime;
+    uint16_t pulse;
+
+    if (time >= duration) {
+      pulse = toPulse(axis, axis->distance);
+      axis->startTime = millis();
+      axis->state = SERVO_SETTLING;
+    } else {
+      pulse = toPulse(axis, travelled(axis, time));
+    }
+
+    if (pulse != axis->pulse) {
+      axis->pulse = pulse;
+      axis->servo.writeMicroseconds(pulse);
+    }
+  }
+}
+
+// Accelerates to the speed, cruises, then decelerates. When the distance is
+// too short to reach the speed the profile is a triangle.
+void ServoMotion::plan(ServoAxis *axis) {
+  uint16_t degrees = axis->target > axis->start ? axis->target - axis->start : axis->start - axis->target;
+  uint16_t speed = axis->speed;
+  uint32_t accelTime = 0;
+
+  if (axis->acceleration > 0) {
+    if ((uint32_t)speed * speed > (uint32_t)degrees * axis->acceleration) {
+      speed = max(sqrt((float)degrees * axis->acceleration), 1);
+    }
+
+    accelTime = (uint32_t)speed * 1000 / axis->acceleration;
+  }
+
+  uint32_t distance = degrees * 1000UL;
+  uint32_t rampDistance = (uint32_t)speed * accelTime;  // both ramps
+
+  noInterrupts();
+  axis->distance = distance;
+  axis->peakSpeed = speed;
+  axis->accelTime = accelTime;
+  axis->cruiseTime = distance > rampDistance ? (distance - rampDistance) / speed : 0;
+  interrupts();
+}
+
+// millidegrees from the start at this time
+uint32_t ServoMotion::travelled(ServoAxis *axis, uint32_t time) {
+  uint32_t speed = axis->peakSpeed;
+  uint32_t rampEnd = speed * axis->accelTime / 2;
+
+  if (time < axis->accelTime) {
+    return (uint32_t)axis->acceleration * time / 2 * time / 1000;
+  }
+
+  time -= axis->accelTime;
+
+  if (time < axis->cruiseTime) {
+    return rampEnd + speed * time;
+  }
+
+  time -= axis->cruiseTime;
+  uint32_t travel = rampEnd + speed * axis->cruiseTime + speed * time - (uint32_t)axis->acceleration * time / 2 * time / 1000;
+  return min(travel, axis->distance);
+}
+
+uint16_t ServoMotion::toPulse(ServoAxis *axis, uint32_t travel) {
+  uint32_t start = axis->start * 1000UL;
+  uint32_t position = axis->target > axis->start ? start + travel : start - travel;
+
+  return MIN_PULSE_WIDTH + (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH) * position / 180000UL;
+}
+
+// Timer 0 compare B fires once per millis() tick
+void ServoMotion::setTick(bool enable) {
+  if (enable) {
+    OCR0B = 0x80;
+    TIMSK0 |= _BV(OCIE0B);
+  } else {
+    TIMSK0 &= ~_BV(OCIE0B);
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef ServoMotion_h
+#define ServoMotion_h
+
+#include "Arduino.h"
+#include <Servo.h>
+
+#define SERVO_MOTION_MAX 2
+#define SERVO_NO_POWER_PIN 0xFF
+#define SERVO_POWER_UP_MS 5
+
+typedef void (*ServoMotionCallback)(byte index, byte position);
+
+enum ServoMotionState { SERVO_IDLE, SERVO_POWERING, SERVO_MOVING, SERVO_SETTLING };
+
+struct ServoAxis {
+  Servo servo;
+  byte pin;
+  byte powerPin;
+  volatile byte state;
+  byte start;
+  byte target;
+  uint16_t speed;          // degrees per second
+  uint16_t acceleration;   // degrees per second per second, 0 for none
+  uint16_t settle;         // ms the servo holds its target before power off
+  // profile, distances in millidegrees and times in ms
+  uint32_t distance;
+  uint16_t peakSpeed;
+  uint32_t accelTime;
+  uint32_t cruiseTime;
+  unsigned long startTime;
+  uint16_t pulse;
+};
+
+// Moves servos with trapezoidal speed profiles: the position is a function of
+// the time since the start, computed from a ~1 kHz tick. The servo is powered
+// and attached only while it moves and settles.
+// The sketch forwards TIMER0_COMPB_vect to tick() and calls update() from loop(),
+// which runs the power sequence and the completion callback.
+class ServoMotion
+{
+  public:
+    ServoMotion();
+    byte add(byte pin, byte powerPin, byte position);
+    void setProfile(byte index, uint16_t speed, uint16_t acceleration, uint16_t settle);
+    void onDone(ServoMotionCallback callback);
+    void moveTo(byte index, byte position);
+    bool isMoving(byte index);
+    bool isMoving();
+    byte getPosition(byte index);
+    void update();
+    void tick();
+
+  private:
+    void plan(ServoAxis *axis);
+    uint32_t travelled(ServoAxis *axis, uint32_t time);
+    uint16_t toPulse(ServoAxis *axis, uint32_t travel);
+    void setTick(bool enable);
+
+    ServoAxis _axes[SERVO_MOTION_MAX];
+    byte _count;
+    ServoMotionCallback _callback;
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include "SirenPattern.h"
+
+const SirenStep SIREN_ALARM[] PROGMEM = {
+  {100, 10, 0},                        // chirp 100 ms
+  {0, 100, SIREN_REPEAT_PARAM},        // silence 1 s
+  {100, SIREN_DURATION_PARAM, 0},
+  SIREN_END
+};
+
+const SirenStep SIREN_CHIRPS[] PROGMEM = {
+  {100, 10, 0},
+  {0, 100, SIREN_REPEAT_PARAM},
+  SIREN_END
+};
+
+SirenPattern::SirenPattern(byte pin) {
+  _pin = pin;
+  _pattern = NULL;
+  _hasUploaded = false;
+  _playing = false;
+  _finished = false;
+}
+
+void SirenPattern::begin() {
+  pinMode(_pin, OUTPUT);
+  output(0);
+
+  // CTC mode, prescaler 64
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+  OCR1A = F_CPU / 64 / (1000 / SIREN_TICK_MS) - 1;
+  TCNT1 = 0;
+  interrupts();
+}
+
+void SirenPattern::play(const SirenStep *pattern, byte level, byte repeat, unsigned long duration) {
+  stop();
+  _pattern = pattern;
+  start(level, repeat, duration);
+}
+
+bool SirenPattern::playUploaded(byte level, byte repeat, unsigned long duration) {
+  if (!_hasUploaded) {
+    return false;
+  }
+
+  stop();
+  _pattern = NULL;
+  start(level, repeat, duration);
+  return true;
+}
+
+// steps format: level,duration,repeat;level,duration,repeat...
+bool SirenPattern::upload(const char *steps) {
+  SirenStep parsed[SIREN_MAX_STEPS + 1];
+  byte count = 0;
+
+  while (*steps != '\0' && count < SIREN_MAX_STEPS) {
+    char *end;
+    unsigned long level = strtoul(steps, &end, 10);
+    unsigned long duration = 0;
+    unsigned long repeat = 0;
+
+    if (*end == ',') {
+      duration = strtoul(end + 1, &end, 10);
+    }
+
+    if (*end == ',') {
+      repeat = strtoul(end + 1, &end, 10);
+    } else {
+      return false;
+    }
+
+    // the play() parameters cannot be uploaded
+    if ((*end != ';' && *end != '\0') || level > 100 || duration == 0 || duration >= SIREN_DURATION_PARAM ||
+        repeat >= SIREN_REPEAT_PARAM) {
+      return false;
+    }
+
+    parsed[count].level = level;
+    parsed[count].duration = duration;
+    parsed[count].repeat = repeat;
+    count++;
+    steps = *end == ';' ? end + 1 : end;
+  }
+
+  if (count == 0 || *steps != '\0') {
+    return false;
+  }
+
+  parsed[count].level = 0;
+  parsed[count].duration = 0;
+  parsed[count].repeat = 0;
+
+  stop();
+  memcpy(_uploaded, parsed, sizeof(SirenStep) * (count + 1));
+  _hasUploaded = true;
+  return true;
+}
+
+void SirenPattern::stop() {
+  TIMSK1 &= ~_BV(OCIE1A);
+  _playing = false;
+  output(0);
+}
+
+bool SirenPattern::isPlaying() {
+  return _playing;
+}
+
+// true once after a pattern has played to its end
+bool SirenPattern::hasFinished() {
+  noInterrupts();
+  bool finished = _finished;
+  _finished = false;
+  interrupts();
+
+  return finished;
+}
+
+void SirenPattern::start(byte level, byte repeat, unsigned long duration) {
+  _level = level;
+  _repeat = repeat;
+  _duration = duration / SIREN_TICK_MS;
+  _finished = false;
+  _playing = true;
+
+  enterGroup(0);
+
+  noInterrupts();
+  TCNT1 = 0;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+  interrupts();
+}
+
+void SirenPattern::handleInterrupt() {
+  if (!_playing || --_ticksLeft > 0) {
+    return;
+  }
+
+  if (_step < _groupEnd) {
+    enterStep(_step + 1);
+  } else if (_groupLeft > 1) {
+    _groupLeft--;
+    enterStep(_groupStart);
+  } else {
+    enterGroup(_groupEnd + 1);
+  }
+}
+
+SirenStep SirenPattern::readStep(byte index) {
+  SirenStep step;
+
+  if (_pattern == NULL) {
+    step = _uploaded[index];
+  } else {
+    memcpy_P(&step, &_pattern[index], sizeof(SirenStep));
+  }
+
+  return step;
+}
+
+// find the end of the group starting at index, skip it if it is repeated 0 times
+void SirenPattern::enterGroup(byte index) {
+  while (true) {
+    SirenStep step = readStep(index);
+
+    if (step.duration == 0) {
+      stop();
+      _finished = true;
+      return;
+    }
+
+    byte end = index;
+
+    while (step.repeat == 0) {
+      SirenStep next = readStep(end + 1);
+
+      if (next.duration == 0) {
+        break;
+      }
+
+      end++;
+      step = next;
+    }
+
+    byte count = step.repeat == SIREN_REPEAT_PARAM ? _repeat : max(step.repeat, 1);
+
+    if (count > 0) {
+      _groupStart = index;
+      _groupEnd = end;
+      _groupLeft = count;
+      enterStep(index);
+      return;
+    }
+
+    index = end + 1;
+  }
+}
+
+void SirenPattern::enterStep(byte index) {
+  SirenStep step = readStep(index);
+
+  _step = index;
+  _ticksLeft = step.duration == SIREN_DURATION_PARAM ? _duration : step.duration;
+  if (_ticksLeft == 0) {
+    _ticksLeft = 1;
+  }
+
+  output((unsigned int)step.level * _level / 100);
+}
+
+void SirenPattern::output(byte level) {
+  analogWrite(_pin, map(level, 0, 100, 0, 255));
+}
@@ -0,0 +1,62 @@
+#ifndef SirenPattern_h
+#define SirenPattern_h
+
+#include "Arduino.h"
+
+#define SIREN_TICK_MS 10
+#define SIREN_MAX_STEPS 6            // steps of an uploaded pattern
+#define SIREN_REPEAT_PARAM 0xFF      // repeat given to play()
+#define SIREN_DURATION_PARAM 0xFFFF  // duration given to play()
+#define SIREN_END {0, 0, 0}
+
+// level in percent of the level given to play(), duration in ticks of
+// SIREN_TICK_MS, repeat != 0 closes a group of steps played repeat times.
+// A group without repeat before SIREN_END is played once.
+struct SirenStep {
+  byte level;
+  uint16_t duration;
+  byte repeat;
+};
+
+extern const SirenStep SIREN_ALARM[];   // repeat chirps then continuous tone for duration
+extern const SirenStep SIREN_CHIRPS[];  // repeat chirps only
+
+// Plays a pattern from a 10 ms timer 1 interrupt, the sketch forwards
+// TIMER1_COMPA_vect to handleInterrupt()
+class SirenPattern
+{
+  public:
+    SirenPattern(byte pin);
+    void begin();
+    void play(const SirenStep *pattern, byte level, byte repeat, unsigned long duration);
+    bool playUploaded(byte level, byte repeat, unsigned long duration);
+    bool upload(const char *steps);
+    void stop();
+    bool isPlaying();
+    bool hasFinished();
+    void handleInterrupt();
+
+  private:
+    void start(byte level, byte repeat, unsigned long duration);
+    SirenStep readStep(byte index);
+    void enterGroup(byte index);
+    void enterStep(byte index);
+    void output(byte level);
+
+    byte _pin;
+    const SirenStep *_pattern;   // PROGMEM, NULL when playing the uploaded one
+    SirenStep _uploaded[SIREN_MAX_STEPS + 1];
+    bool _hasUploaded;
+    byte _level;
+    byte _repeat;
+    unsigned long _duration;     // ticks
+    volatile bool _playing;
+    volatile bool _finished;
+    byte _step;
+    byte _groupStart;
+    byte _groupEnd;
+    byte _groupLeft;
+    unsigned long _ticksLeft;
+};
+
+#endif
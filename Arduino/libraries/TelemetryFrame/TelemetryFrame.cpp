@@ -0,0 +1,86 @@
+#include "TelemetryFrame.h"
+
+TelemetryFrame::TelemetryFrame() {
+  clear();
+}
+
+void TelemetryFrame::clear() {
+  _buffer[0] = TELEMETRY_FRAME_VERSION;
+  _buffer[1] = TELEMETRY_NO_BATTERY;
+  _buffer[2] = 0;
+  _buffer[3] = 0;
+  _count = 0;
+}
+
+bool TelemetryFrame::add(byte sensor, byte type, int16_t value, byte decimals) {
+  if (_count >= TELEMETRY_MAX_VALUES) {
+    return false;
+  }
+
+  byte* p = &_buffer[TELEMETRY_HEADER_SIZE + _count * TELEMETRY_VALUE_SIZE];
+  p[0] = sensor;
+  p[1] = type;
+  p[2] = (uint16_t)value & 0xFF;
+  p[3] = (uint16_t)value >> 8;
+  p[4] = decimals;
+  _count++;
+
+  return true;
+}
+
+void TelemetryFrame::setBattery(byte percent, uint16_t millivolts) {
+  _buffer[1] = percent;
+  _buffer[2] = millivolts & 0xFF;
+  _buffer[3] = millivolts >> 8;
+}
+
+bool TelemetryFrame::decode(const void* payload, byte length) {
+  const byte* p = (const byte*)payload;
+
+  if (length < TELEMETRY_HEADER_SIZE || length > sizeof(_buffer) || p[0] != TELEMETRY_FRAME_VERSION ||
+      (length - TELEMETRY_HEADER_SIZE) % TELEMETRY_VALUE_SIZE != 0) {
+    clear();
+    return false;
+  }
+
+  memcpy(_buffer, p, length);
+  _count = (length - TELEMETRY_HEADER_SIZE) / TELEMETRY_VALUE_SIZE;
+
+  return true;
+}
+
+byte TelemetryFrame::getCount() {
+  return _count;
+}
+
+TelemetryValue TelemetryFrame::getValue(byte index) {
+  const byte* p = &_buffer[TELEMETRY_HEADER_SIZE + index * TELEMETRY_VALUE_SIZE];
+  TelemetryValue value;
+
+  value.sensor = p[0];
+  value.type = p[1];
+  value.value = (int16_t)(p[2] | (uint16_t)p[3] << 8);
+  value.decimals = p[4];
+
+  return value;
+}
+
+byte TelemetryFrame::getBatteryPercent() {
+  return _buffer[1];
+}
+
+uint16_t TelemetryFrame::getBatteryMillivolts() {
+  return _buffer[2] | (uint16_t)_buffer[3] << 8;
+}
+
+bool TelemetryFrame::isEmpty() {
+  return _count == 0 && _buffer[1] == TELEMETRY_NO_BATTERY;
+}
+
+const void* TelemetryFrame::data() {
+  return _buffer;
+}
+
+byte TelemetryFrame::length() {
+  return TELEMETRY_HEADER_SIZE + _count * TELEMETRY_VALUE_SIZE;
+}
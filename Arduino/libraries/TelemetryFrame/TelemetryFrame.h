@@ -0,0 +1,43 @@
+#ifndef TelemetryFrame_h
+#define TelemetryFrame_h
+
+#include "Arduino.h"
+
+#define TELEMETRY_CHILD_ID 200
+#define TELEMETRY_FRAME_VERSION 1
+#define TELEMETRY_HEADER_SIZE 4
+#define TELEMETRY_VALUE_SIZE 5
+#define TELEMETRY_MAX_VALUES 4       // header and values fit the 25 bytes payload
+#define TELEMETRY_NO_BATTERY 0xFF
+
+// frame format: version, battery percent, battery millivolts (LE),
+// then for each value: sensor, type, value (LE), decimals
+struct TelemetryValue {
+  byte sensor;
+  byte type;
+  int16_t value;     // fixed point, value / 10^decimals
+  byte decimals;
+};
+
+class TelemetryFrame
+{
+  public:
+    TelemetryFrame();
+    void clear();
+    bool add(byte sensor, byte type, int16_t value, byte decimals);
+    void setBattery(byte percent, uint16_t millivolts);
+    bool decode(const void* payload, byte length);
+    byte getCount();
+    TelemetryValue getValue(byte index);
+    byte getBatteryPercent();
+    uint16_t getBatteryMillivolts();
+    bool isEmpty();
+    const void* data();
+    byte length();
+
+  private:
+    byte _buffer[TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_VALUES * TELEMETRY_VALUE_SIZE];
+    byte _count;
+};
+
+#endif
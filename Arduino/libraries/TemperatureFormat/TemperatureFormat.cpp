@@ -0,0 +1,20 @@
+#include "TemperatureFormat.h"
+
+char* formatTemperature(int16_t centiDegrees, char* buffer) {
+  // long: rounding 327.67 degrees overflows an int
+  int16_t tenths = (centiDegrees + (centiDegrees < 0 ? -5L : 5L)) / 10;
+  char* p = buffer;
+
+  if (tenths < 0) {
+    *p++ = '-';
+    tenths = -tenths;
+  }
+
+  itoa(tenths / 10, p, 10);
+  p += strlen(p);
+  *p++ = '.';
+  *p++ = '0' + tenths % 10;
+  *p = '\0';
+
+  return buffer;
+}
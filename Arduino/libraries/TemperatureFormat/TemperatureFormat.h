@@ -0,0 +1,11 @@
+#ifndef TemperatureFormat_h
+#define TemperatureFormat_h
+
+#include "Arduino.h"
+
+#define TEMPERATURE_FORMAT_SIZE 8  // "-327.7" and its terminator
+
+// Format hundredths of degrees with one decimal without float printf
+char* formatTemperature(int16_t centiDegrees, char* buffer);
+
+#endif
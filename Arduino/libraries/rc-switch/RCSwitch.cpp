@@ -171,6 +171,11 @@ void RCSwitch::setReceiveTolerance(int nPercent) {
 void RCSwitch::enableTransmit(int nTransmitterPin) {
   this->nTransmitterPin = nTransmitterPin;
   pinMode(this->nTransmitterPin, OUTPUT);
+#if defined( __AVR__ )
+  // the pulses are written on the port directly, without the pin lookups of digitalWrite()
+  this->transmitterOutput = portOutputRegister(digitalPinToPort(nTransmitterPin));
+  this->transmitterBit = digitalPinToBitMask(nTransmitterPin);
+#endif
 }
 
 /**
@@ -520,12 +525,27 @@ void RCSwitch::transmit(HighLow pulses) {
   uint8_t firstLogicLevel = (this->protocol.invertedSignal) ? LOW : HIGH;
   uint8_t secondLogicLevel = (this->protocol.invertedSignal) ? HIGH : LOW;
   
-  digitalWrite(this->nTransmitterPin, firstLogicLevel);
+  this->writeTransmitter(firstLogicLevel);
   delayMicroseconds( this->protocol.pulseLength * pulses.high);
-  digitalWrite(this->nTransmitterPin, secondLogicLevel);
+  this->writeTransmitter(secondLogicLevel);
   delayMicroseconds( this->protocol.pulseLength * pulses.low);
 }
 
+inline void RCSwitch::writeTransmitter(uint8_t level) {
+#if defined( __AVR__ )
+  uint8_t oldSREG = SREG;
+  cli();
+  if (level == HIGH) {
+    *this->transmitterOutput |= this->transmitterBit;
+  } else {
+    *this->transmitterOutput &= ~this->transmitterBit;
+  }
+  SREG = oldSREG;
+#else
+  digitalWrite(this->nTransmitterPin, level);
+#endif
+}
+
 
 #if not defined( RCSwitchDisableReceiving )
 /**
@@ -126,6 +126,7 @@ class RCSwitch {
     char* getCodeWordC(char sFamily, int nGroup, int nDevice, bool bStatus);
     char* getCodeWordD(char group, int nDevice, bool bStatus);
     void transmit(HighLow pulses);
+    void writeTransmitter(uint8_t level);
 
     #if not defined( RCSwitchDisableReceiving )
     static void handleInterrupt();
@@ -133,6 +134,10 @@ class RCSwitch {
     int nReceiverInterrupt;
     #endif
     int nTransmitterPin;
+    #if defined( __AVR__ )
+    volatile uint8_t *transmitterOutput;
+    uint8_t transmitterBit;
+    #endif
     int nRepeatTransmit;
     
     Protocol protocol;
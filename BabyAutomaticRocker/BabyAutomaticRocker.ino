@@ -2,12 +2,16 @@
 #include <EEPROM.h>
 #include <TMC2208Stepper.h>
 #include <SoftwareSerial.h>
+#include <FastPin.h>
 
 #define STEPMOTOR 200
 #define MICROSTEP 2
 #define STEP_DIST_RATIO (500 * MICROSTEP) / 15                     // step numbers divided by robot distance (cm)
-#define ACCELERATION_FREQUENCY 10.0                   // milliseconds
-#define ACCELERATION_SPEED (500.0 / (1000.0 / ACCELERATION_FREQUENCY)) // 500 RPM of acceleration in 1 second
+#define ACCELERATION_RPM 500UL                                     // 500 RPM of acceleration in 1 second at 100%
+
+#define TIMER_TICKS_PER_SECOND (F_CPU / 8)                          // timer 1 with prescaler 8
+#define RAMP_LEVELS 32                                              // speed levels between start and cruise speed
+#define RAMP_START_RPM 5                                            // slowest speed with a step interval on 16 bits
 
 #define MOTOR1_DIR_PIN 8
 #define MOTOR1_STEP_PIN 4
@@ -35,25 +39,31 @@
 enum State_enum {FIX, ACCELERATION, CRUISE, DECELERATION};
 enum MoveStatus_enum {FORWARD, BACKWARD};
 
+struct RampLevel {
+  uint16_t interval;  // timer ticks between two steps
+  uint16_t steps;     // steps at this speed
+};
+
 TMC2208Stepper driver1 = TMC2208Stepper(-1, MOTOR1_UART_PIN, false);
 TMC2208Stepper driver2 = TMC2208Stepper(-1, MOTOR2_UART_PIN, false);
 SoftwareSerial ble(BLE_TX_PIN, BLE_RX_PIN); // RX, TX
+typedef FastPin<MOTOR1_STEP_PIN> Motor1Step;
+typedef FastPin<MOTOR2_STEP_PIN> Motor2Step;
 
 int travelSpeedRpm;
 int travelDistanceCm;
 int travelTimeMinute;
 byte accelerationPercent;
-unsigned long previousTime = micros();
-unsigned long stateTimer = millis();
-unsigned long stepperFrequency;
-float accelerationRpm;
-float currentSpeedRpm;
+RampLevel ramp[RAMP_LEVELS];
+byte rampLevel;
+uint16_t levelStepsLeft;
+unsigned long rampSteps;
 unsigned long stepCpt;
 unsigned long nbStepToDestination;
-unsigned long stepNumberToActivateDeceleration;
-uint8_t state = FIX;
+volatile uint8_t state = FIX;
+volatile uint16_t maxStepLatency = 0;  // timer ticks from compare match to step
 uint8_t moveStatus;
-int cruiseSpeedRpm;
+bool moving = false;
 bool run;
 int motorCurrent;
 unsigned long startTimer;
@@ -77,10 +87,16 @@ void setup()
   pinMode(MOTOR2_SLP_PIN, OUTPUT);
   pinMode(MOTOR1_DIR_PIN, OUTPUT);
   pinMode(MOTOR2_DIR_PIN, OUTPUT);
-  pinMode(MOTOR1_STEP_PIN, OUTPUT);
-  pinMode(MOTOR2_STEP_PIN, OUTPUT);
+  Motor1Step::output();
+  Motor2Step::output();
   pinMode(BUTTON_1, INPUT);
 
+  // timer 1 in CTC mode, the step interval is in OCR1A
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS11);
+  interrupts();
+
   sleepMotors();
 
   if (digitalRead(BLE_LINK_PIN) == HIGH) {
@@ -93,17 +109,17 @@ void setup()
 
 void loop()
 {
-  if (state != FIX) {
-    moveRobot();
-
+  if (moving) {
+    // the move is over when the timer interrupt sets state to FIX
     if (state == FIX) {
       if (moveStatus == FORWARD) {
         changeMoveStatus(BACKWARD);
-        changeState(ACCELERATION);
+        startMove();
       } else {
         if (run) {
           startRobot();
         } else {
+          moving = false;
           sleepMotors();
         }
       }
@@ -114,28 +130,50 @@ void loop()
     }
   }
 
-  if (digitalRead(BUTTON_1) == LOW) {
+  manageButton();
+  manageBleMessage();
+}
+
+// Stops on press while running, otherwise starts on release after a 1.5 s press
+inline void manageButton() {
+  static unsigned long pressTime = 0;
+  static bool pressed = false;
+  static bool stopPress = false;
+
+  bool down = digitalRead(BUTTON_1) == LOW;
+
+  if (down == pressed || millis() - pressTime < 50) {
+    return;
+  }
+
+  if (down) {
+    pressed = true;
+    pressTime = millis();
+    stopPress = run;
+
     if (run) {
       urgentStop();
-    } else {
-      delay(500);
-      unsigned long waitTime = millis();
-      while (digitalRead(BUTTON_1) == LOW);
+    }
+  } else {
+    pressed = false;
 
-      if ((millis() - waitTime) >= 1000) {
-        start();
-      }
+    if (!stopPress && millis() - pressTime >= 1500) {
+      start();
     }
 
-    delay(500);
+    pressTime = millis();
   }
-
-  manageBleMessage();
 }
 
 void start() {
-  wakeUpMotors();
-  startRobot();
+  // the timer interrupt reads the ramp and the step count of a running move:
+  // it keeps them, loop() starts the next move with the new ones
+  if (moving) {
+    run = true;
+  } else {
+    wakeUpMotors();
+    startRobot();
+  }
   startTimer = millis();
 
   if (digitalRead(BLE_LINK_PIN) == HIGH) {
@@ -153,7 +191,8 @@ void stop() {
 
 void urgentStop() {
   stopRobot();
-  changeState(FIX);
+  stopMove();
+  moving = false;
   sleepMotors();
 
   if (digitalRead(BLE_LINK_PIN) == HIGH) {
@@ -161,94 +200,123 @@ void urgentStop() {
   }
 }
 
-inline void moveRobot() {
-  unsigned long currentTime = micros();
+void startRobot() {
+  changeMoveStatus(FORWARD);
+  nbStepToDestination = (float) travelDistanceCm * STEP_DIST_RATIO;
+  buildRamp();
+  startMove();
+  moving = true;
+  run = true;
+}
+
+void stopRobot() {
+  run = false;
+}
+
+// Speed levels from RAMP_START_RPM to the travel speed, each one held for the
+// same time so the acceleration is constant
+void buildRamp() {
+  unsigned long startRpm16 = RAMP_START_RPM * 16UL;
+  unsigned long cruiseRpm16 = max(travelSpeedRpm, RAMP_START_RPM + 1) * 16UL;
+  unsigned long acceleration = max(ACCELERATION_RPM * accelerationPercent / 100, 1UL);
+  unsigned long levelTicks = (cruiseRpm16 - startRpm16) / 16 * (TIMER_TICKS_PER_SECOND / RAMP_LEVELS) / acceleration;
+
+  for (byte i = 0; i < RAMP_LEVELS; i++) {
+    unsigned long rpm16 = startRpm16 + (cruiseRpm16 - startRpm16) * (i + 1) / RAMP_LEVELS;
+    ramp[i].interval = TIMER_TICKS_PER_SECOND * 60UL * 16UL / (rpm16 * MICROSTEP * STEPMOTOR);
+    ramp[i].steps = max(levelTicks / ramp[i].interval, 1UL);
+  }
+}
+
+void startMove() {
+  noInterrupts();
+  stepCpt = 0;
+  rampSteps = 0;
+  rampLevel = 0;
+  levelStepsLeft = ramp[0].steps;
+  state = ACCELERATION;
+  OCR1A = ramp[0].interval;
+  TCNT1 = 0;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+  interrupts();
+}
 
-  if (currentTime - previousTime >= stepperFrequency) {
-    previousTime = currentTime;
+void stopMove() {
+  TIMSK1 &= ~_BV(OCIE1A);
+  state = FIX;
+}
 
-    digitalWrite(MOTOR1_STEP_PIN, HIGH);
-    digitalWrite(MOTOR2_STEP_PIN, HIGH);
-    digitalWrite(MOTOR1_STEP_PIN, LOW);
-    digitalWrite(MOTOR2_STEP_PIN, LOW);
+inline void stepMotors() {
+  Motor1Step::high();
+  Motor2Step::high();
+  Motor1Step::low();
+  Motor2Step::low();
+}
 
-    stepCpt++;
+// Steps both motors then loads the interval of the next step. The deceleration
+// walks back the levels of the acceleration, so it takes as many steps.
+ISR(TIMER1_COMPA_vect) {
+  uint16_t latency = TCNT1;
 
-    if (stepCpt == stepNumberToActivateDeceleration) {
-      changeState(DECELERATION);
-    } else if (stepCpt == nbStepToDestination) {
-      changeState(FIX);
-    }
+  stepMotors();
+
+  if (latency > maxStepLatency) {
+    maxStepLatency = latency;
   }
 
-  if ((millis() - stateTimer) >= ACCELERATION_FREQUENCY) {
-    if (state == ACCELERATION) {
-      currentSpeedRpm += accelerationRpm;
-      computeStepperFrequency();
+  stepCpt++;
 
-      if (currentSpeedRpm >= cruiseSpeedRpm) {
-        changeState(CRUISE);
-      }
-    } else if (state == DECELERATION) {
-      currentSpeedRpm -= accelerationRpm;
+  if (stepCpt >= nbStepToDestination) {
+    stopMove();
+    return;
+  }
 
-      if (currentSpeedRpm < 1.0) {
-        currentSpeedRpm = 1.0;
-      }
+  if (state == ACCELERATION) {
+    rampSteps++;
 
-      computeStepperFrequency();
+    if (--levelStepsLeft == 0) {
+      if (rampLevel == RAMP_LEVELS - 1) {
+        state = CRUISE;
+      } else {
+        rampLevel++;
+        levelStepsLeft = ramp[rampLevel].steps;
+      }
     }
+  }
 
-    stateTimer = millis();
+  if (state != DECELERATION && nbStepToDestination - stepCpt <= rampSteps) {
+    // steps already done at the current level
+    levelStepsLeft = state == CRUISE ? ramp[rampLevel].steps : ramp[rampLevel].steps - levelStepsLeft;
+    state = DECELERATION;
   }
-}
 
-void startRobot() {
-  changeMoveStatus(FORWARD);
-  cruiseSpeedRpm = travelSpeedRpm;
-  nbStepToDestination = (float) travelDistanceCm * STEP_DIST_RATIO;
-  accelerationRpm = ACCELERATION_SPEED * accelerationPercent / 100.0;
-  changeState(ACCELERATION);
-  run = true;
-}
+  if (state == DECELERATION) {
+    while (levelStepsLeft == 0 && rampLevel > 0) {
+      rampLevel--;
+      levelStepsLeft = ramp[rampLevel].steps;
+    }
 
-void stopRobot() {
-  run = false;
-}
+    if (levelStepsLeft > 0) {
+      levelStepsLeft--;
+    }
+  }
+
+  OCR1A = ramp[rampLevel].interval;
 
-void changeState(State_enum newState) {
-  switch (newState) {
-    case ACCELERATION:
-      stepCpt = 0;
-      currentSpeedRpm = 1.0;
-      computeStepperFrequency();
-      stepNumberToActivateDeceleration = nbStepToDestination / 2;
-      state = ACCELERATION;
-      stateTimer = millis();
-      //Serial.println("ACCELERATION");
-      break;
-    case CRUISE:
-      currentSpeedRpm = cruiseSpeedRpm;
-      computeStepperFrequency();
-      stepNumberToActivateDeceleration = nbStepToDestination - stepCpt;
-      state = CRUISE;
-      stateTimer = millis();
-      //Serial.println("CRUISE");
-      break;
-    case DECELERATION:
-      state = DECELERATION;
-      stateTimer = millis();
-      //Serial.println("DECELERATION");
-      break;
-    case FIX:
-      state = FIX;
-      //Serial.println("FIX");
-      break;
+  // already past a shorter interval: step on the next tick instead of after a wrap
+  if (TCNT1 >= OCR1A) {
+    TCNT1 = OCR1A - 1;
   }
 }
 
-inline void computeStepperFrequency() {
-  stepperFrequency = 60000000 / (currentSpeedRpm * MICROSTEP * STEPMOTOR);
+uint16_t getMaxStepJitter() {
+  noInterrupts();
+  uint16_t latency = maxStepLatency;
+  maxStepLatency = 0;
+  interrupts();
+
+  return latency * 1000000UL / TIMER_TICKS_PER_SECOND;
 }
 
 inline void manageBleMessage() {
@@ -343,10 +411,7 @@ void stealthChop2Autotune() {
 
   // 300 step at velocity between 60-300 RPM
   for (int i = 0; i < 300; i++) {
-    digitalWrite(MOTOR1_STEP_PIN, HIGH);
-    digitalWrite(MOTOR2_STEP_PIN, HIGH);
-    digitalWrite(MOTOR1_STEP_PIN, LOW);
-    digitalWrite(MOTOR2_STEP_PIN, LOW);
+    stepMotors();
     delayMicroseconds(timeToWait);
   }
 }
@@ -383,6 +448,7 @@ void sendDataToBleDevice() {
   ble.println("accel:" + String(accelerationPercent));
   ble.println("timer:" + String(travelTimeMinute));
   ble.println("current:" + String(motorCurrent));
+  ble.println("jitter:" + String(getMaxStepJitter()));
 }
 
 void measureStepDistanceRatio() {
@@ -390,10 +456,7 @@ void measureStepDistanceRatio() {
   unsigned long timeToWait = 60000000 / (rpm * MICROSTEP * STEPMOTOR);
 
   for (int i = 0; i < 1000; i++) {
-    digitalWrite(MOTOR1_STEP_PIN, HIGH);
-    digitalWrite(MOTOR2_STEP_PIN, HIGH);
-    digitalWrite(MOTOR1_STEP_PIN, LOW);
-    digitalWrite(MOTOR2_STEP_PIN, LOW);
+    stepMotors();
     delayMicroseconds(timeToWait);
   }
 }
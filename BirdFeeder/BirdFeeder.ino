@@ -11,51 +11,50 @@
 
 #include <MySensors.h>
 #include <Servo.h>
+#include <ServoMotion.h>
 #include <Parser.h>
+#include <BatteryLevel.h>
 
 #define SERVO_POWER_PIN 4
 #define SERVO_PIN 5
 #define BATTERY_LEVEL_PIN A0
-#define EEPROM_VOLTAGE_CORRECTION 0
+#define EEPROM_VOLTAGE_CORRECTION EEPROM_LOCAL_CONFIG_ADDRESS + 0 // 4 bytes storage
 #define EEPROM_SERVO_POS 1
+#define EEPROM_DISCHARGE_TRACKER EEPROM_LOCAL_CONFIG_ADDRESS + 8 // 5 bytes storage
 #define SERVO_UNLOCK_POS 41
 #define SERVO_LOCK_POS 136
-
-struct FuelGauge {
-  float voltage;
-  int percent;
-};
+#define SERVO_SPEED 25         // degrees per second
+#define SERVO_ACCELERATION 50  // degrees per second per second
+#define SERVO_SETTLE 1000      // ms
 
 enum state_enum {SLEEPING, RUNNING, GOING_TO_SLEEP};
 uint8_t _state;
 
-Servo _servo;
-byte _servoPosition;
-byte _servoTarget;
-bool _servoMoving;
-unsigned long _servoTimeChange = 0;
-unsigned long _servoSpeed = 40;
+ServoMotion motion;
 
 Parser parser = Parser(' ');
 MyMessage msg(0, V_CUSTOM);
 unsigned long _goingToSleepTimer;
 unsigned long _cpt = 0;
 
-float _voltageCorrection = 1;
-const int _lionTab[] = {3500, 3550, 3590, 3610, 3640, 3710, 3790, 3880, 3970, 4080, 4200};
+BatteryLevel battery(BATTERY_LEVEL_PIN, EEPROM_VOLTAGE_CORRECTION, LITHIUM_CURVE);
 int _batteryPercent = 101;
 
+ISR(TIMER0_COMPB_vect) {
+  motion.tick();
+}
+
 void before() {
-  _servoPosition = loadState(EEPROM_SERVO_POS); // Set position to last known state (using eeprom storage)
-  _servoMoving = false;
+  motion.add(SERVO_PIN, SERVO_POWER_PIN, loadState(EEPROM_SERVO_POS)); // Set position to last known state (using eeprom storage)
+  motion.setProfile(0, SERVO_SPEED, SERVO_ACCELERATION, SERVO_SETTLE);
+  motion.onDone(onGateDone);
 
-  //saveVoltageCorrection(1.013333333333333); // Measured by multimeter divided by reported
-  _voltageCorrection = getVoltageCorrection();
-  analogReference(INTERNAL);
-  getFuelGauge(); // first read is wrong
-  FuelGauge gauge = getFuelGauge();
+  //battery.saveVoltageCorrection(1.013333333333333); // Measured by multimeter divided by reported
+  battery.init();
+  battery.compute();
+  battery.enableDischargeTracking(EEPROM_DISCHARGE_TRACKER);
 
-  if (gauge.voltage <= 3.5) {
+  if (battery.getRawMillivolts() <= 3500) {
     sleep(0);
   }
 }
@@ -63,8 +62,6 @@ void before() {
 void setup() {
   _state = SLEEPING;
   _cpt = 0;
-  pinMode(SERVO_POWER_PIN, OUTPUT);
-  digitalWrite(SERVO_POWER_PIN, LOW);
 
   _batteryPercent = 101;
   reportBatteryLevel();
@@ -87,12 +84,12 @@ void receive(const MyMessage &message)
     parser.parse(message.getString());
 
     if (parser.isEqual(0, "close")) {
-      if (!_servoMoving) {
+      if (!motion.isMoving()) {
         changeState(RUNNING);
         closeGate();
       }
     } else if (parser.isEqual(0, "open")) {
-      if (!_servoMoving) {
+      if (!motion.isMoving()) {
         changeState(RUNNING);
         openGate();
       }
@@ -113,10 +110,11 @@ void loop() {
     if (_cpt == 21600) { // 6H
       _cpt = 0;
       reportBatteryLevel();
+      battery.trackDischarge(12); // 21600 * 2s
       sendHeartbeat();
     }
   } else if (_state == RUNNING) {
-    manageServo();
+    motion.update();
   } else if (_state == GOING_TO_SLEEP) {
     if (millis() - _goingToSleepTimer > 500) {
       changeState(SLEEPING);
@@ -139,133 +137,60 @@ void changeState(uint8_t state) {
 }
 
 void openGate() {
-  powerOnServo();
-  _servoTarget = SERVO_UNLOCK_POS;
-  _servoMoving = true;
+  send(msg.set(F("moving gate...")));
+  motion.moveTo(0, SERVO_UNLOCK_POS);
 }
 
 void closeGate() {
-  powerOnServo();
-  _servoTarget = SERVO_LOCK_POS;
-  _servoMoving = true;
-}
-
-void powerOnServo() {
-  digitalWrite(SERVO_POWER_PIN, HIGH);
-  delay(5);
+  send(msg.set(F("moving gate...")));
+  motion.moveTo(0, SERVO_LOCK_POS);
 }
 
 void powerOffServo() {
   digitalWrite(SERVO_POWER_PIN, LOW);
 }
 
-inline void manageServo() {
-  if (_servoMoving) {
-    // start servo
-    if (!_servo.attached()) {
-      send(msg.set(F("moving gate...")));
-      _servo.attach(SERVO_PIN);
-      _servoTimeChange = millis();
-    }
-
-    // Move servo
-    if (_servo.attached() && millis() - _servoTimeChange > _servoSpeed) {
-      if (_servoTarget > _servoPosition) {
-        _servoPosition++;
-        _servo.write(_servoPosition);
-      } else if (_servoTarget < _servoPosition) {
-        _servoPosition--;
-        _servo.write(_servoPosition);
-      } else {
-        if (_servoTarget == SERVO_UNLOCK_POS) {
-          send(msg.set(F("Gate open")));
-        } else {
-          send(msg.set(F("Gate close")));
-        }
-
-        // save in eeprom
-        if (loadState(EEPROM_SERVO_POS) != _servoTarget) {
-          saveState(EEPROM_SERVO_POS, _servoTarget);
-        }
-
-        delay(1000);
-        _servo.detach();
-        _servoMoving = false;
-        powerOffServo();
-        changeState(GOING_TO_SLEEP);
-      }
+void onGateDone(byte index, byte position) {
+  if (position == SERVO_UNLOCK_POS) {
+    send(msg.set(F("Gate open")));
+  } else {
+    send(msg.set(F("Gate close")));
+  }
 
-      _servoTimeChange = millis();
-    }
+  // save in eeprom
+  if (loadState(EEPROM_SERVO_POS) != position) {
+    saveState(EEPROM_SERVO_POS, position);
   }
+
+  changeState(GOING_TO_SLEEP);
 }
 
 void reportBatteryLevel() {
-  FuelGauge gauge = getFuelGauge();
+  battery.compute();
 
 #ifdef MY_DEBUG
   Serial.print(F("Voltage: "));
-  Serial.print(gauge.voltage);
+  Serial.print(battery.getVoltage());
   Serial.print(F(" ("));
-  Serial.print(gauge.percent);
+  Serial.print(battery.getPercent());
   Serial.println(F("%)"));
 #endif
 
-  if (gauge.percent < _batteryPercent) {
-    String voltageMsg = "voltage-" + String(gauge.voltage) + "-" + String(gauge.percent);
+  if (battery.getPercent() < _batteryPercent) {
+    String voltageMsg = "voltage-" + String(battery.getVoltage()) + "-" + String(battery.getPercent());
     send(msg.set(voltageMsg.c_str()));
-    sendBatteryLevel(gauge.percent);
-    _batteryPercent = gauge.percent;
+    sendBatteryLevel(battery.getPercent());
+    _batteryPercent = battery.getPercent();
+
+    if (battery.getDaysRemaining() != BATTERY_DAYS_UNKNOWN) {
+      String daysMsg = "days-" + String(battery.getDaysRemaining());
+      send(msg.set(daysMsg.c_str()));
+    }
   }
 
-  if (gauge.voltage <= 3.5) {
+  if (battery.getRawMillivolts() <= 3500) {
     powerOffServo();
     send(msg.set(F("Battery too low: sleep")));
     sleep(0);
   }
 }
-
-FuelGauge getFuelGauge() {
-  FuelGauge gauge;
-  int analog = analogRead(BATTERY_LEVEL_PIN);  // 0 - 1023
-  float u2 = (analog * 1.1) / 1023.0;
-  gauge.voltage = (u2 * (470000.0 + 100000.0)) / 100000.0;
-  gauge.voltage *= _voltageCorrection;
-
-  int um = round(gauge.voltage * 1000.0);
-
-  for (byte i = 10; i >= 0; i--) {
-    if (um >= _lionTab[i]) {
-      if (i == 10) {
-        gauge.percent = 100;
-      } else {
-        gauge.percent = map(um, _lionTab[i], _lionTab[i + 1], i * 10, i * 10 + 10);
-      }
-
-      break;
-    } else {
-      gauge.percent = 0;
-    }
-  }
-
-  return gauge;
-}
-
-void saveVoltageCorrection(float value) {
-  byte *b = (byte *)&value;
-
-  for (byte i = 0; i < sizeof(value); i++) {
-    saveState(EEPROM_VOLTAGE_CORRECTION + i, b[i]);
-  }
-}
-
-float getVoltageCorrection() {
-  float value = 0.0;
-  byte *b = (byte *)&value;
-
-  for (byte i = 0; i < sizeof(value); i++) {
-    *b++ = loadState(EEPROM_VOLTAGE_CORRECTION + i);
-  }
-
-  return value;
-}
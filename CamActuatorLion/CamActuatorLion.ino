@@ -11,13 +11,15 @@
 
 #include <MySensors.h>
 #include <Parser.h>
+#include <BatteryLevel.h>
 #include <SoftwareSerial.h>
 
 #define CAM_POWER_PIN 5
 #define BATTERY_LEVEL_PIN A0
 #define ESP32_RX_PIN 6
 #define ESP32_TX_PIN 7
-#define EEPROM_VOLTAGE_CORRECTION 0
+#define EEPROM_VOLTAGE_CORRECTION EEPROM_LOCAL_CONFIG_ADDRESS + 0 // 4 bytes storage
+#define EEPROM_DISCHARGE_TRACKER EEPROM_LOCAL_CONFIG_ADDRESS + 4  // 5 bytes storage
 
 #if defined(BOARD_V2)
 #define ESP32_P12_PIN 4
@@ -29,11 +31,6 @@
 #define ESP32_P13_PIN A1
 #endif
 
-struct FuelGauge {
-  float voltage;
-  int percent;
-};
-
 enum state_enum {SLEEPING, RUNNING, STOP_CAM, GOING_TO_SLEEP};
 uint8_t _state;
 
@@ -53,8 +50,7 @@ SoftwareSerial esp32Serial(ESP32_TX_PIN, ESP32_RX_PIN); // RX, TX
 char esp32Data[25];
 byte esp32DataCpt = 0;
 
-float _voltageCorrection = 1;
-const int _lionTab[] = {3500, 3550, 3590, 3610, 3640, 3710, 3790, 3880, 3970, 4080, 4200};
+BatteryLevel battery(BATTERY_LEVEL_PIN, EEPROM_VOLTAGE_CORRECTION, LITHIUM_CURVE);
 int _batteryPercent = 101;
 
 void before() {
@@ -62,13 +58,12 @@ void before() {
   pinMode(CAM_POWER_PIN, OUTPUT);
   digitalWrite(CAM_POWER_PIN, LOW);
 
-  //saveVoltageCorrection(0.9986876640419948); // Measured by multimeter divided by reported
-  _voltageCorrection = getVoltageCorrection();
-  analogReference(INTERNAL);
-  getFuelGauge(); // first read is wrong
-  FuelGauge gauge = getFuelGauge();
+  //battery.saveVoltageCorrection(0.9986876640419948); // Measured by multimeter divided by reported
+  battery.init();
+  battery.compute();
+  battery.enableDischargeTracking(EEPROM_DISCHARGE_TRACKER);
 
-  if (gauge.voltage <= 3.5) {
+  if (battery.getRawMillivolts() <= 3500) {
     sleep(0);
   }
 }
@@ -80,7 +75,7 @@ void setup() {
   reportBatteryLevel();
 
   /*
-    saveVoltageCorrection(1.0);
+    battery.saveVoltageCorrection(1.0);
     while(1) {
     delay(3000);
     reportBatteryLevel();
@@ -134,6 +129,7 @@ void loop() {
     if (_cpt == 21600) { // 6H
       _cpt = 0;
       reportBatteryLevel();
+      battery.trackDischarge(6);
       sendHeartbeat();
     }
   } else if (_state == RUNNING) {
@@ -223,24 +219,29 @@ void stopCam() {
 }
 
 void reportBatteryLevel() {
-  FuelGauge gauge = getFuelGauge();
+  battery.compute();
 
 #ifdef MY_DEBUG
   Serial.print(F("Voltage: "));
-  Serial.print(gauge.voltage);
+  Serial.print(battery.getVoltage());
   Serial.print(F(" ("));
-  Serial.print(gauge.percent);
+  Serial.print(battery.getPercent());
   Serial.println(F("%)"));
 #endif
 
-  if (gauge.percent < _batteryPercent) {
-    String voltageMsg = "voltage-" + String(gauge.voltage) + "-" + String(gauge.percent);
+  if (battery.getPercent() < _batteryPercent) {
+    String voltageMsg = "voltage-" + String(battery.getVoltage()) + "-" + String(battery.getPercent());
     send(msg.set(voltageMsg.c_str()));
-    sendBatteryLevel(gauge.percent);
-    _batteryPercent = gauge.percent;
+    sendBatteryLevel(battery.getPercent());
+    _batteryPercent = battery.getPercent();
+
+    if (battery.getDaysRemaining() != BATTERY_DAYS_UNKNOWN) {
+      String daysMsg = "days-" + String(battery.getDaysRemaining());
+      send(msg.set(daysMsg.c_str()));
+    }
   }
 
-  if (gauge.voltage <= 3.5) {
+  if (battery.getRawMillivolts() <= 3500) {
     stopCam();
 #if defined(BOARD_V1)
     esp32Serial.end();
@@ -249,48 +250,3 @@ void reportBatteryLevel() {
     sleep(0);
   }
 }
-
-FuelGauge getFuelGauge() {
-  FuelGauge gauge;
-  int analog = analogRead(BATTERY_LEVEL_PIN);  // 0 - 1023
-  float u2 = (analog * 1.1) / 1023.0;
-  gauge.voltage = (u2 * (470000.0 + 100000.0)) / 100000.0;
-  gauge.voltage *= _voltageCorrection;
-
-  int um = round(gauge.voltage * 1000.0);
-
-  for (byte i = 10; i >= 0; i--) {
-    if (um >= _lionTab[i]) {
-      if (i == 10) {
-        gauge.percent = 100;
-      } else {
-        gauge.percent = map(um, _lionTab[i], _lionTab[i + 1], i * 10, i * 10 + 10);
-      }
-
-      break;
-    } else {
-      gauge.percent = 0;
-    }
-  }
-
-  return gauge;
-}
-
-void saveVoltageCorrection(float value) {
-  byte *b = (byte *)&value;
-
-  for (byte i = 0; i < sizeof(value); i++) {
-    saveState(EEPROM_VOLTAGE_CORRECTION + i, b[i]);
-  }
-}
-
-float getVoltageCorrection() {
-  float value = 0.0;
-  byte *b = (byte *)&value;
-
-  for (byte i = 0; i < sizeof(value); i++) {
-    *b++ = loadState(EEPROM_VOLTAGE_CORRECTION + i);
-  }
-
-  return value;
-}
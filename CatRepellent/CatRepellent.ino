@@ -8,16 +8,13 @@
 
 #include <MySensors.h>
 #include <Parser.h>
+#include <BatteryLevel.h>
 
 #define PUMP_PIN 5
 #define WATER_SENSOR_PIN A0
 #define BATTERY_LEVEL_PIN A1
-#define EEPROM_VOLTAGE_CORRECTION 0
-
-struct FuelGauge {
-  float voltage;
-  int percent;
-};
+#define EEPROM_VOLTAGE_CORRECTION EEPROM_LOCAL_CONFIG_ADDRESS + 0 // 4 bytes storage
+#define EEPROM_DISCHARGE_TRACKER EEPROM_LOCAL_CONFIG_ADDRESS + 4  // 5 bytes storage
 
 enum state_enum {SLEEPING, RUNNING};
 uint8_t _state;
@@ -27,23 +24,21 @@ Parser parser = Parser(' ');
 unsigned long _cpt = 0;
 unsigned long _runningTime = 0;
 unsigned long _stateTimer = 0;
-float _voltageCorrection = 1.0;
+BatteryLevel battery(BATTERY_LEVEL_PIN, EEPROM_VOLTAGE_CORRECTION, LEAD_ACID_12V_CURVE);
 int _batteryPercent = 101;
 
 void before()
 {
   pinMode(PUMP_PIN, INPUT);
   pinMode(WATER_SENSOR_PIN, INPUT);
-  pinMode(BATTERY_LEVEL_PIN, INPUT);
   _state = SLEEPING;
   _cpt = 0;
   _batteryPercent = 101;
 
-  //saveVoltageCorrection(0.9845); // Measured by multimeter divided by reported
-  _voltageCorrection = getVoltageCorrection();
-  analogReference(INTERNAL);
-  getFuelGauge(); // first read is wrong
-  FuelGauge gauge = getFuelGauge();
+  //battery.saveVoltageCorrection(0.9845); // Measured by multimeter divided by reported
+  battery.setDivider(1000000, 47000);
+  battery.init();
+  battery.enableDischargeTracking(EEPROM_DISCHARGE_TRACKER);
 }
 
 void setup()
@@ -89,6 +84,7 @@ void loop()
     if (_cpt == 21600) { // 6H
       _cpt = 0;
       reportBatteryLevel();
+      battery.trackDischarge(6);
       sendHeartbeat();
     }
   } else if (_state == RUNNING) {
@@ -136,52 +132,25 @@ bool isWaterTankEmpty() {
 }
 
 void reportBatteryLevel() {
-  FuelGauge gauge = getFuelGauge();
+  battery.compute();
 
 #ifdef MY_DEBUG
   Serial.print(F("Voltage: "));
-  Serial.print(gauge.voltage, 4);
+  Serial.print(battery.getVoltage(), 4);
   Serial.print(F(" ("));
-  Serial.print(gauge.percent);
+  Serial.print(battery.getPercent());
   Serial.println(F("%)"));
 #endif
 
-  if (gauge.percent < _batteryPercent) {
-    String voltageMsg = "voltage-" + String(gauge.voltage) + "-" + String(gauge.percent);
+  if (battery.getPercent() < _batteryPercent) {
+    String voltageMsg = "voltage-" + String(battery.getVoltage()) + "-" + String(battery.getPercent());
     send(msg.set(voltageMsg.c_str()));
-    sendBatteryLevel(gauge.percent);
-    _batteryPercent = gauge.percent;
-  }
-}
-
-FuelGauge getFuelGauge() {
-  FuelGauge gauge;
-  int analog = analogRead(BATTERY_LEVEL_PIN);  // 0 - 1023
-  float u2 = (analog * 1.1) / 1023.0;
-  gauge.voltage = (u2 * (1000000.0 + 47000.0)) / 47000.0;
-  gauge.voltage *= _voltageCorrection;
-
-  int um = round(gauge.voltage * 1000.0);
-  gauge.percent = map(um, 12000, 13000, 0, 100);
-
-  return gauge;
-}
+    sendBatteryLevel(battery.getPercent());
+    _batteryPercent = battery.getPercent();
 
-void saveVoltageCorrection(float value) {
-  byte *b = (byte *)&value;
-
-  for (byte i = 0; i < sizeof(value); i++) {
-    saveState(EEPROM_VOLTAGE_CORRECTION + i, b[i]);
-  }
-}
-
-float getVoltageCorrection() {
-  float value = 0.0;
-  byte *b = (byte *)&value;
-
-  for (byte i = 0; i < sizeof(value); i++) {
-    *b++ = loadState(EEPROM_VOLTAGE_CORRECTION + i);
+    if (battery.getDaysRemaining() != BATTERY_DAYS_UNKNOWN) {
+      String daysMsg = "days-" + String(battery.getDaysRemaining());
+      send(msg.set(daysMsg.c_str()));
+    }
   }
-
-  return value;
 }
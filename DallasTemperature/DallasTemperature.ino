@@ -4,6 +4,10 @@
 // Enable REPORT_BATTERY_LEVEL to measure battery level and send changes to gateway
 #define REPORT_BATTERY_LEVEL
 
+// Enable TELEMETRY_FRAME to send all values and the battery in one packed message, expanded by the gateway
+// (update the gateway first, the controller only sees the expanded values)
+//#define TELEMETRY_FRAME
+
 #define MY_RADIO_RF24
 #define MY_RF24_PA_LEVEL (RF24_PA_MAX)
 #define MY_TRANSPORT_MAX_TX_FAILURES (3u)
@@ -18,6 +22,8 @@
 #include <SPI.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include <TemperatureFormat.h>
+#include <TelemetryFrame.h>
 
 // 1 = lounge
 // 2 = bedroom
@@ -47,13 +53,16 @@ static Vcc _vcc(_vccCorrection);
 #endif
 
 #define TEMPERATURE_PRECISION 11 //Max 12 bit, min 9 bit
+#define DALLAS_MAX_SENSORS 4
+
+// Define EEPROM addresses
+#define EEPROM_DALLAS_DEVICES EEPROM_LOCAL_CONFIG_ADDRESS + 0 // DEVICE_TABLE_EEPROM_SIZE(DALLAS_MAX_SENSORS) bytes storage
 
 // Temperature sensor
 OneWire oneWire(PIN_TEMPERATURE);
 DallasTemperature sensors(&oneWire);
-byte dallasSensorAddress[8];
+DeviceAddress dallasSensors[DALLAS_MAX_SENSORS];
 
-float temp = 0.0;
 int oldLight = -100;
 unsigned int _cpt = 0;
 bool success = false;
@@ -61,6 +70,11 @@ bool success = false;
 MyMessage msgTemp(0, V_TEMP);
 MyMessage msgLight(1, V_LIGHT_LEVEL);
 
+#ifdef TELEMETRY_FRAME
+TelemetryFrame frame;
+MyMessage msgFrame(TELEMETRY_CHILD_ID, V_CUSTOM);
+#endif
+
 void setup() {
   randomSeed(analogRead(0));//initialise la séquence aléatoir
   initializeDallasSensor();
@@ -74,26 +88,47 @@ void presentation() {
   // Present sensor to controller
   present(0, S_TEMP);
   present(1, S_LIGHT_LEVEL);
+#ifdef TELEMETRY_FRAME
+  present(TELEMETRY_CHILD_ID, S_MULTIMETER);
+#endif
 }
 
 void loop() {
+  int photocell = readPhotocell();
+  bool lightChanged = abs(photocell - oldLight) > 10;
+
+  if (lightChanged) {
+    oldLight = photocell;
+    DEBUG_PRINT(F("Light: "));
+    DEBUG_PRINT(photocell);
+  }
+
   // Every 10 minutes
   if (_cpt % 60 == 0) {
-    temp = getDallasTemperature();
+    requestDallasTemperature();
+
+    // 9bit requres 94ms, 10bit 188ms, 11bit 375ms and 12bit resolution takes 750ms
+    sleep(sensors.millisToConversionDeadline());
+    sendDallasTemperature();
+    powerOffDallasSensor();
 
-    DEBUG_PRINT(F("Temperature: "));
-    DEBUG_PRINT(temp);
-    
-    send(msgTemp.set(temp, 1));
     reportBatteryLevel();
-  }
 
-  int photocell = readPhotocell();
+#ifdef TELEMETRY_FRAME
+    // The light level rides along with the temperature
+    if (lightChanged) {
+      frame.add(1, V_LIGHT_LEVEL, photocell, 0);
+      lightChanged = false;
+    }
+
+    if (!frame.isEmpty()) {
+      send(msgFrame.set(frame.data(), frame.length()));
+    }
+    frame.clear();
+#endif
+  }
 
-  if (abs(photocell - oldLight) > 10) {
-    oldLight = photocell;
-    DEBUG_PRINT(F("Light: "));
-    DEBUG_PRINT(photocell);
+  if (lightChanged) {
     send(msgLight.set(photocell));
   }
 
@@ -108,36 +143,52 @@ void initializeDallasSensor() {
   // Allow 50ms for the sensor to be ready
   delay(50);
 
-  sensors.begin();
+  // Probe addresses are restored from EEPROM, the bus is only searched if they do not answer
+  sensors.begin(EEPROM_DALLAS_DEVICES, dallasSensors, DALLAS_MAX_SENSORS);
   sensors.setWaitForConversion(false);
-  int numSensors = sensors.getDeviceCount();
-  oneWire.search(dallasSensorAddress);
-  sensors.setResolution(dallasSensorAddress, TEMPERATURE_PRECISION);
+  sensors.setResolution(TEMPERATURE_PRECISION);
 
   // set power pin for DS18B20 to input before sleeping, saves power
   digitalWrite(PIN_ALIM_TEMPERATURE, LOW);
   pinMode(PIN_ALIM_TEMPERATURE, INPUT);
 }
 
-float getDallasTemperature() {
+void requestDallasTemperature() {
   pinMode(PIN_ALIM_TEMPERATURE, OUTPUT);
   digitalWrite(PIN_ALIM_TEMPERATURE, HIGH);
   sleep(30);
 
-  sensors.setResolution(dallasSensorAddress, TEMPERATURE_PRECISION);
-  sensors.requestTemperatures(); // Send the command to get temperatures
+  sensors.setResolution(TEMPERATURE_PRECISION);
+  sensors.requestTemperaturesAsync(NULL); // Start conversion on all probes
+}
+
+void sendDallasTemperature() {
+  TemperatureReading readings[DALLAS_MAX_SENSORS];
+  byte count = sensors.getDeviceCount();
 
-  // 9bit requres 95ms, 10bit 187ms, 11bit 375ms and 12bit resolution takes 750ms
-  sleep(400);
+  // Read every probe scratchpad in one pass
+  sensors.readTemperatures(readings);
 
-  // Fetch and round temperature to one decimal
-  float temperature = sensors.getTempC(dallasSensorAddress);
+  for (byte i = 0; i < count; i++) {
+    DEBUG_PRINT(F("Temperature (centi C) / conversion (ms): "));
+    DEBUG_PRINT(readings[i].centiCelsius);
+    DEBUG_PRINT(readings[i].conversionMillis);
+  }
 
+  if (count > 0) {
+#ifdef TELEMETRY_FRAME
+    frame.add(0, V_TEMP, readings[0].centiCelsius, 2);
+#else
+    char buffer[TEMPERATURE_FORMAT_SIZE];
+    send(msgTemp.set(formatTemperature(readings[0].centiCelsius, buffer)));
+#endif
+  }
+}
+
+void powerOffDallasSensor() {
   // set power pin for DS18B20 to input before sleeping, saves power
   digitalWrite(PIN_ALIM_TEMPERATURE, LOW);
   pinMode(PIN_ALIM_TEMPERATURE, INPUT);
-
-  return temperature;
 }
 
 int readPhotocell() {
@@ -166,7 +217,11 @@ void reportBatteryLevel() {
   // Battery readout should only go down. So report only when new value is smaller than previous one.
   if ( batteryPcnt < _oldBatteryPcnt )
   {
+#ifdef TELEMETRY_FRAME
+    frame.setBattery(batteryPcnt, _vcc.Read_Volts() * 1000);
+#else
     sendBatteryLevel(batteryPcnt);
+#endif
     _oldBatteryPcnt = batteryPcnt;
   }
 }
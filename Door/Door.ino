@@ -17,15 +17,34 @@
 
 #include <MySensors.h>
 #include <BatteryLevel.h>
+#include <SendQueue.h>
+#include <EdgeLatch.h>
+#include <EventCoalescer.h>
 
 #define DOOR_ID 0
+#define LATENCY_ID 1
+#define BURST_ID 2
 #define DOOR_PIN 2
 #define OPEN_STATUS LOW
+#define HOUSEKEEPING_INTERVAL 43200000UL // 12H
+#define BURST_WINDOW 10000UL
 
 MyMessage msg(DOOR_ID, V_TRIPPED);
+MyMessage msgLatency(LATENCY_ID, V_CUSTOM);
+MyMessage msgBurst(BURST_ID, V_CUSTOM);
 BatteryLevel battery(INTERNAL_MEASUREMENT, EEPROM_VOLTAGE_CORRECTION, CR2032_LITHIUM);
 int batteryPercent = 101;
 uint8_t sentValue = 2;
+uint8_t reportedValue = 2; // last state pushed on DOOR_ID
+unsigned long sleptTime = 0;         // millis() does not run while sleeping
+unsigned long housekeepingTime = 0;  // node time of the last latency report
+SendQueue sendQueue;
+EdgeLatch doorLatch(DOOR_PIN);
+EventCoalescer doorBurst(BURST_WINDOW);
+
+ISR(PCINT2_vect) {
+  doorLatch.handleInterrupt();
+}
 
 void before()
 {
@@ -41,25 +60,103 @@ void presentation()
   sendSketchInfo("Door", "2.0");
   wait(500);
   present(DOOR_ID, S_DOOR, "Contact (closed/open)");
+  present(LATENCY_ID, S_CUSTOM, "Edge to ACK latency");
+  present(BURST_ID, S_CUSTOM, "Event burst");
+}
+
+void setup()
+{
+  doorLatch.begin();
 }
 
 void receive(const MyMessage &myMsg)
 {
   DEBUG_PRINT("message received");
+
+  if (sendQueue.receive(myMsg) && myMsg.sensor == DOOR_ID) {
+    doorLatch.acknowledged();
+  }
 }
 
 void loop()
 {
-  delay(50); // Short delay to allow buttons to properly settle
-  uint8_t tripped = digitalRead(DOOR_PIN);
+  // Event first: the state latched by the interrupt is sent before anything else
+  if (doorLatch.available()) {
+    uint8_t tripped = doorLatch.read();
+
+    if (tripped != sentValue) {
+      DEBUG_PRINT("tripped");
+
+      // only the first edge of a burst is sent, the next ones go in its summary
+      if (doorBurst.event(tripped)) {
+        sendQueue.push(msg.set(tripped == OPEN_STATUS));
+        reportedValue = tripped;
+      }
+      sentValue = tripped;
+    }
+  }
 
-  if (tripped != sentValue) {
-    DEBUG_PRINT("tripped");
-    sendWithRetry(msg.set(tripped == OPEN_STATUS), 10);
-    sentValue = tripped;
+  if (doorBurst.summaryDue()) {
+    // the burst can end in another state than its first edge
+    if (doorBurst.getState() != reportedValue) {
+      reportedValue = doorBurst.getState();
+      sendQueue.push(msg.set(reportedValue == OPEN_STATUS));
+    }
+
+    String burstMsg = "burst-" + String(doorBurst.getState() == OPEN_STATUS) + "-" + String(doorBurst.getCount()) + "-" + String(doorBurst.getDuration());
+    sendQueue.push(msgBurst.set(burstMsg.c_str()));
+    doorBurst.summarySent();
+  }
+
+  sendQueue.process();
+
+  if (!sendQueue.isEmpty()) {
+    // keep watching the contact while retrying, a newer state replaces the queued one
+    unsigned long next = sendQueue.timeToNext();
+    wait(min(next, SEND_QUEUE_POLL));
+    return;
   }
 
-  delay(100);
+  // Housekeeping once the state has reached the gateway
+  reportBatteryLevel();
+  housekeeping();
+
+  if (!doorLatch.available()) {
+    // a summary due by now must not turn into a sleep without timeout
+    unsigned long sleepTime = doorLatch.sleepTime(max(min(doorBurst.timeToSummary(), timeToHousekeeping()), 1UL));
+    sleep(digitalPinToInterrupt(DOOR_PIN), CHANGE, sleepTime);
+
+    unsigned long slept = sleepTime - getSleepRemaining();
+    doorBurst.slept(slept);
+    sleptTime += slept;
+  }
+}
+
+// millis() plus the time slept, as EventCoalescer counts it
+unsigned long nodeTime()
+{
+  return millis() + sleptTime;
+}
+
+// Latency is reported every HOUSEKEEPING_INTERVAL of node time, however
+// often the edges cut the sleeps short
+void housekeeping()
+{
+  if (nodeTime() - housekeepingTime >= HOUSEKEEPING_INTERVAL) {
+    reportLatency();
+    housekeepingTime = nodeTime();
+  }
+}
+
+unsigned long timeToHousekeeping()
+{
+  unsigned long elapsed = nodeTime() - housekeepingTime;
+
+  return elapsed >= HOUSEKEEPING_INTERVAL ? 0 : HOUSEKEEPING_INTERVAL - elapsed;
+}
+
+void reportBatteryLevel()
+{
   battery.compute();
   //String voltageMsg = "voltage-" + String(battery.getVoltage()) + "-" + String(battery.getPercent());
   //Serial.println(voltageMsg);
@@ -67,32 +164,13 @@ void loop()
     sendBatteryLevel(battery.getPercent());
     batteryPercent = battery.getPercent();
   }
-
-  if (digitalRead(DOOR_PIN) == sentValue) {
-    sleep(digitalPinToInterrupt(DOOR_PIN), CHANGE, 0);
-  }
 }
 
-void sendWithRetry(MyMessage &message, const byte retryNumber) {
-  byte counter = retryNumber;
-  bool success = false;
-
-  do {
-    DEBUG_PRINT("send message");
-    success = send(message, true);
-
-    if (success) {
-      success = wait(500, message.getCommand(), message.type);
-
-      if (!success) {
-        DEBUG_PRINT("no software ACK");
-      }
-    } else {
-      DEBUG_PRINT("no hardware ACK");
-    }
-    
-    if (!success && counter != 0 && (retryNumber - counter) > 0) {
-      sleep(500 * (retryNumber - counter));
-    }
-  } while (!success && counter--);
+void reportLatency()
+{
+  if (doorLatch.getCount() > 0) {
+    String latencyMsg = "latency-" + String(doorLatch.getAverageLatency()) + "-" + String(doorLatch.getMaxLatency());
+    send(msgLatency.set(latencyMsg.c_str()));
+    doorLatch.resetLatency();
+  }
 }
@@ -7,13 +7,24 @@
 #define MY_TRANSPORT_MAX_TX_FAILURES (3u)
 
 #include <MySensors.h>
+#include <EdgeLatch.h>
 
 #define DOORMAT_ID 0
+#define LATENCY_ID 1
 #define DOORMAT_PIN 2
 #define LED_PIN 4
 //#define LED_ENABLE
+#define HOUSEKEEPING_INTERVAL 43200000UL // 12H
 
 MyMessage msg(DOORMAT_ID, V_STATUS);
+MyMessage msgLatency(LATENCY_ID, V_CUSTOM);
+EdgeLatch doormatLatch(DOORMAT_PIN);
+unsigned long sleptTime = 0;         // millis() does not run while sleeping
+unsigned long housekeepingTime = 0;  // node time of the last latency report
+
+ISR(PCINT2_vect) {
+  doormatLatch.handleInterrupt();
+}
 
 #ifdef REPORT_BATTERY_LEVEL
 #include <Vcc.h>
@@ -39,47 +50,85 @@ void setup() {
 
     delay(50);
   }
+
+  doormatLatch.begin();
 }
 
 void presentation()
 {
   sendSketchInfo("Doormat", "1.0");
   present(DOORMAT_ID, S_BINARY);
+  present(LATENCY_ID, S_CUSTOM, "Edge to ACK latency");
 }
 
 void loop() {
-  uint8_t value;
   static uint8_t sentValue = 2;
 
-  // Short delay to allow the sensor to properly settle
-  delay(50);
+  // Event first: the state latched by the interrupt is sent before anything else
+  if (doormatLatch.available()) {
+    uint8_t value = doormatLatch.read();
+
+    if (value != sentValue) {
+      sendValue(value);
+      sentValue = value;
+    }
+  }
+
+  // Housekeeping once the value has been sent
+  reportBatteryLevel();
+  housekeeping();
+
+  // Sleep until something happens with the sensor
+  if (!doormatLatch.available()) {
+    unsigned long sleepTime = max(doormatLatch.sleepTime(timeToHousekeeping()), 1UL);
+    sleep(digitalPinToInterrupt(DOORMAT_PIN), CHANGE, sleepTime);
+    sleptTime += sleepTime - getSleepRemaining();
+  }
+}
+
+// millis() plus the time slept, as EventCoalescer counts it
+unsigned long nodeTime() {
+  return millis() + sleptTime;
+}
+
+// Latency is reported every HOUSEKEEPING_INTERVAL of node time, however
+// often the edges cut the sleeps short
+void housekeeping() {
+  if (nodeTime() - housekeepingTime >= HOUSEKEEPING_INTERVAL) {
+    reportLatency();
+    housekeepingTime = nodeTime();
+  }
+}
 
-  value = digitalRead(DOORMAT_PIN);
+unsigned long timeToHousekeeping() {
+  unsigned long elapsed = nodeTime() - housekeepingTime;
 
-  if (value != sentValue) {
+  return elapsed >= HOUSEKEEPING_INTERVAL ? 0 : HOUSEKEEPING_INTERVAL - elapsed;
+}
 
+void sendValue(uint8_t value) {
 #ifdef LED_ENABLE
-    if (value == HIGH) {
-      digitalWrite(LED_PIN, HIGH);
-    } else {
-      digitalWrite(LED_PIN, LOW);
-    }
+  if (value == HIGH) {
+    digitalWrite(LED_PIN, HIGH);
+  } else {
+    digitalWrite(LED_PIN, LOW);
+  }
 #endif
 
-    // Value has changed from last transmission, send the updated value
-    for (char i = 0; i < 5; i++) {
-      bool success = send(msg.set(value == HIGH));
+  // Value has changed from last transmission, send the updated value
+  for (char i = 0; i < 5; i++) {
+    bool success = send(msg.set(value == HIGH));
 
-      if (success) {
-        i = 100;
-      } else {
-        delay(100);
-      }
+    if (success) {
+      doormatLatch.acknowledged();
+      i = 100;
+    } else {
+      delay(100);
     }
-
-    sentValue = value;
   }
+}
 
+void reportBatteryLevel() {
 #ifdef REPORT_BATTERY_LEVEL
   const uint8_t batteryPcnt = static_cast<uint8_t>(0.5 + vcc.Read_Perc(VccMin, VccMax));
 
@@ -98,8 +147,13 @@ void loop() {
     oldBatteryPcnt = batteryPcnt;
   }
 #endif
+}
 
-  // Sleep until something happens with the sensor
-  sleep(DOORMAT_PIN - 2, CHANGE, 0);
+void reportLatency() {
+  if (doormatLatch.getCount() > 0) {
+    String latencyMsg = "latency-" + String(doormatLatch.getAverageLatency()) + "-" + String(doormatLatch.getMaxLatency());
+    send(msgLatency.set(latencyMsg.c_str()));
+    doormatLatch.resetLatency();
+  }
 }
 
@@ -13,6 +13,7 @@
 #include <Adafruit_Fingerprint.h>
 #include <MySensors.h>
 #include <Parser.h>
+#include <SendQueue.h>
 
 #define FINGER_RX 4
 #define FINGER_TX 5
@@ -30,6 +31,7 @@ Adafruit_Fingerprint _finger = Adafruit_Fingerprint(&_fingerSerial);
 unsigned long _timer = 0;
 bool _successMsgReceived = false;
 bool _configMode = false;
+SendQueue _sendQueue(50);
 
 void before() {
   pinMode(FINGER_WAKEUP, INPUT);
@@ -61,6 +63,10 @@ void setup() {
 }
 
 void receive(const MyMessage &message) {
+  if (_sendQueue.receive(message)) {
+    return;
+  }
+
   if (message.sensor == CHILD_ID_INFO_MSG && message.type == V_CUSTOM && !message.isAck()) {
     _parser.parse(message.getString());
 
@@ -150,7 +156,10 @@ void foundMatch() {
   // String message = "match-" + String(_finger.fingerID);
   String message = "matched";
 
-  if (sendWithRetry(_msgInfo.set(message.c_str()), 10)) {
+  _sendQueue.push(_msgInfo.set(message.c_str()));
+
+  // wait the echo of the destination node, then its answer
+  if (_sendQueue.flush()) {
     wait(500, C_SET, V_TEXT);
 
     if (_successMsgReceived) {
@@ -210,26 +219,6 @@ void stopFingerPrint() {
   pinMode(FINGER_POWER, INPUT);
 }
 
-boolean sendWithRetry(MyMessage &message, const byte retryNumber) {
-  byte counter = retryNumber;
-  bool success = false;
-
-  do {
-    success = send(message, true);
-
-    if (success) {
-      // wait echo message of the destination node
-      success = wait(500, message.getCommand(), message.type);
-    }
-
-    if (!success && counter != 0 && (retryNumber - counter) > 0) {
-      delay(50 * (retryNumber - counter));
-    }
-  } while (!success && counter--);
-
-  return success;
-}
-
 boolean enrollFingerprintWithMessage(uint8_t id) {
   if (id < 1 || id > 127) {
     send(_msgInfo.set(F("Wrong id")));
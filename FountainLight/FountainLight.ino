@@ -2,6 +2,7 @@
 #include <EEPROM.h>
 #include <SoftwareSerial.h>
 #include <FastLED.h>
+#include <BleCommand.h>
 
 #define BLE_RX_PIN 5
 #define BLE_TX_PIN 6
@@ -17,14 +18,15 @@
 #define EEPROM_STATUS 6     // 1 byte
 
 SoftwareSerial ble(BLE_TX_PIN, BLE_RX_PIN); // RX, TX
+BleCommand bleCommand(ble);
 CRGB leds[NUM_LEDS];
 
 unsigned long _startTime = 0;
-unsigned long _timer;
+byte _timer;
 boolean _lightIsOn = false;
 byte _color[3];
 
-int _animationSelected = 0;
+byte _animationSelected = 0;
 unsigned long _animationTimer = 0;
 int _animationCpt = 0;
 int _animationStep = 0;
@@ -39,12 +41,19 @@ void setup() {
 
   FastLED.addLeds<WS2812, LED_PIN, GRB>(leds, NUM_LEDS);
 
-  _timer = getTimer();
-  _animationSelected = getAnimation();
-  readColor();
-  
+  bleCommand.addCommand(F("start"), onStartCommand);
+  bleCommand.addCommand(F("stop"), onStopCommand);
+  bleCommand.addCommand(F("color"), onColorCommand);
+  bleCommand.addCommand(F("savecolor"), onSaveColorCommand);
+  bleCommand.addCommand(F("name"), onNameCommand);
+  bleCommand.addColor(F("color"), _color, EEPROM_COLOR, onColorSaved);
+  bleCommand.addByte(F("timer"), &_timer, EEPROM_TIMER, 0, 254, 2);
+  bleCommand.addByte(F("animation"), &_animationSelected, EEPROM_ANIMATION, 0, NUM_ANIMATION, 0, onAnimationChanged);
+  bleCommand.onData(sendStatusToBleDevice);
+  bleCommand.load();
+
   Serial.println("Timer: " + String(_timer) + " hour(s)");
-  Serial.println("Animation: " + String(getAnimation()));
+  Serial.println("Animation: " + String(_animationSelected));
 
   for (int i = 0; i < NUM_LEDS; i++) {
     leds[i] = CRGB ( 0, 0, 255);
@@ -59,7 +68,7 @@ void setup() {
   }
 
   if (digitalRead(BLE_LINK_PIN) == HIGH) {
-    sendDataToBleDevice();
+    bleCommand.sendData();
   }
 
   bool isOn = getStatus();
@@ -69,57 +78,9 @@ void setup() {
 }
 
 void loop() {
-  while (ble.available()) {
-    String msg = ble.readStringUntil('\n');
-    Serial.println("ble: " + msg);
-
-    if (msg == "cmd+start") {
-      ble.println("status:on");
-      startLight();
-      saveStatus(true);
-    } else if (msg == "cmd+stop") {
-      ble.println("status:off");
-      stopLight();
-      saveStatus(false);
-    } else if (msg == "cmd+data?") {
-      sendDataToBleDevice();
-    } else if (msg.startsWith("cmd+color=")) {
-      String color = parseCommand(msg, '=', 1);
-      displayColor(color);
-    } else if (msg.startsWith("cmd+savecolor=")) {
-      String color = parseCommand(msg, '=', 1);
-      displayColor(color);
-      saveColor();
-      Serial.println("Color saved: " + color);
-      ble.println("color:" + color);
-
-      if (!_lightIsOn) {
-        stopLight();
-      }
-    } else if (msg.startsWith("cmd+timer=")) {
-      byte timer = parseCommand(msg, '=', 1).toInt();
-      saveTimer(timer);
-      Serial.println("Timer: " + String(timer));
-      ble.println("timer:" + String(timer));
-    } else if (msg.startsWith("cmd+animation=")) {
-      byte animation = parseCommand(msg, '=', 1).toInt();
-      
-      if (animation >= 0 && animation <= NUM_ANIMATION) {
-        saveAnimation(animation);
-        _animationSelected = animation;
-        initAnimation();
-        Serial.println("Animation: " + String(animation));
-        ble.println("animation:" + String(animation));
-      }
-    } else if (msg.startsWith("cmd+name=")) {
-      String name = parseCommand(msg, '=', 1);
-      Serial.println("Name: " + String(name));
-      ble.print("+++");
-      delay(500);
-      ble.print("AT+NAME=[onl] " + name);
-      delay(500);
-      ble.print("AT+EXIT");
-    }
+  if (bleCommand.process()) {
+    Serial.print(F("ble: "));
+    Serial.println(bleCommand.getLine());
   }
 
   if (Serial.available() > 0) {
@@ -152,25 +113,63 @@ void loop() {
   }
 }
 
-void sendDataToBleDevice() {
+void sendStatusToBleDevice() {
   String status =  _lightIsOn ? "on" : "off";
   ble.println("status:" + status);
+  ble.println("animationnb:" + String(NUM_ANIMATION));
+}
 
-  String hexstring = "";
-  for (int i = 0; i < 3; i++) {
-    if (_color[i] < 16) {
-      hexstring += "0" + String(_color[i], HEX);
-    } else {
-      hexstring += String(_color[i], HEX);
-    }
+void onStartCommand(const char *value) {
+  ble.println("status:on");
+  startLight();
+  saveStatus(true);
+}
+
+void onStopCommand(const char *value) {
+  ble.println("status:off");
+  stopLight();
+  saveStatus(false);
+}
+
+// preview, the color is saved by savecolor
+void onColorCommand(const char *value) {
+  if (BleCommand::parseColor(value, _color)) {
+    displayColor();
+  } else {
+    Serial.println("Color not valid!");
   }
+}
 
-  Serial.println("Color: " + hexstring);
-  ble.println("color:" + hexstring);
+void onSaveColorCommand(const char *value) {
+  if (!bleCommand.set("color", value)) {
+    Serial.println("Color not valid!");
+  }
+}
 
-  ble.println("timer:" + String(_timer));
-  ble.println("animation:" + String(getAnimation()));
-  ble.println("animationnb:" + String(NUM_ANIMATION));
+void onColorSaved(const char *value) {
+  displayColor();
+  Serial.print(F("Color saved: "));
+  Serial.println(value);
+
+  if (!_lightIsOn) {
+    stopLight();
+  }
+}
+
+void onAnimationChanged(const char *value) {
+  initAnimation();
+  Serial.println("Animation: " + String(_animationSelected));
+}
+
+void onNameCommand(const char *name) {
+  Serial.print(F("Name: "));
+  Serial.println(name);
+  ble.print("+++");
+  delay(500);
+  ble.print(F("AT+NAME=[onl] "));
+  ble.print(name);
+  delay(500);
+  ble.print("AT+EXIT");
 }
 
 void startLight() {
@@ -195,21 +194,7 @@ void stopLight() {
   _lightIsOn = false;
 }
 
-void displayColor(String color) {
-  if (color.length() != 6) {
-    Serial.println("Color not valid!");
-  }
-
-  char firstByte[3];
-  color.substring(0, 2).toCharArray(firstByte, 3);
-  _color[0] = (byte) strtol(firstByte, NULL, 16);
-
-  color.substring(2, 4).toCharArray(firstByte, 3);
-  _color[1] = (byte) strtol(firstByte, NULL, 16);
-
-  color.substring(4, 6).toCharArray(firstByte, 3);
-  _color[2] = (byte) strtol(firstByte, NULL, 16);
-
+void displayColor() {
   for (int i = 0; i < NUM_LEDS; i++) {
     leds[i] = CRGB (_color[0], _color[1], _color[2]);
   }
@@ -217,73 +202,15 @@ void displayColor(String color) {
   FastLED.show();
 }
 
-void readColor() {
-  _color[0] = EEPROM.read(EEPROM_COLOR);
-  _color[1] = EEPROM.read(EEPROM_COLOR + 1);
-  _color[2] = EEPROM.read(EEPROM_COLOR + 2);
-}
-
-byte getTimer() {
-  byte result = EEPROM.read(EEPROM_TIMER);
-
-  if (result == 255) {
-    result = 2;
-  }
-
-  return result;
-}
-
-byte getAnimation() {
-  byte result = EEPROM.read(EEPROM_ANIMATION);
-
-  if (result == 255) {
-    result = 0;
-  }
-
-  return result;
-}
-
 bool getStatus() {
   bool result = EEPROM.read(EEPROM_STATUS);
   return result;
 }
 
-void saveColor() {
-  EEPROM.update(EEPROM_COLOR, _color[0]);
-  EEPROM.update(EEPROM_COLOR + 1, _color[1]);
-  EEPROM.update(EEPROM_COLOR + 2, _color[2]);
-}
-
-void saveTimer(byte value) {
-  EEPROM.update(EEPROM_TIMER, value);
-  _timer = value;
-}
-
-void saveAnimation(byte value) {
-  EEPROM.update(EEPROM_ANIMATION, value);
-}
-
 void saveStatus(bool value) {
   EEPROM.update(EEPROM_STATUS, value);
 }
 
-String parseCommand(String data, char separator, int index)
-{
-  int found = 0;
-  int strIndex[] = {0, -1};
-  int maxIndex = data.length() - 1;
-
-  for (int i = 0; i <= maxIndex && found <= index; i++) {
-    if (data.charAt(i) == separator || i == maxIndex || data.charAt(i) == '\n' || data.charAt(i) == '\r') {
-      found++;
-      strIndex[0] = strIndex[1] + 1;
-      strIndex[1] = (i == maxIndex) ? i + 1 : i;
-    }
-  }
-
-  return found > index ? data.substring(strIndex[0], strIndex[1]) : "";
-}
-
 void initAnimation() {
   _animationTimer = 0;
   _animationCpt = 0;
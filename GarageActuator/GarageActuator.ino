@@ -15,7 +15,9 @@
 
 #include <MySensors.h>
 #include <Servo.h>
+#include <ServoMotion.h>
 #include <SoftwareSerial.h>
+#include <BleCommand.h>
 
 #define SERVO1_PIN 3
 #define SERVO2_PIN 6
@@ -28,9 +30,11 @@
 #define SERVO1_LOCK_POS 180
 #define SERVO2_UNLOCK_POS 180
 #define SERVO2_LOCK_POS 0
+#define SERVO_SPEED 180         // degrees per second
+#define SERVO_ACCELERATION 360  // degrees per second per second
+#define SERVO_SETTLE 200        // ms
 
 #define PASSWORD_LENGTH 10  // + 1 for then end of string (0)
-#define BUFFER_SIZE 100
 
 #define EEPROM_PASSWORD_POS 10
 #define EEPROM_SERVO1_POS 0
@@ -43,27 +47,37 @@
 MyMessage msgInfo(CHILD_ID_INFO, V_CUSTOM);
 MyMessage msgLock(CHILD_ID_LOCK, V_STATUS);
 SoftwareSerial ble(BLE_TX_PIN, BLE_RX_PIN);  // RX, TX
+BleCommand bleCommand(ble);
+LineReader serialLine(Serial);
 
-Servo _servo1;
-Servo _servo2;
-unsigned long _timeOfLastChange = 0;
+ServoMotion motion;
 bool _action = false;
-byte _servo1_position;
 byte _servo1_target;
-byte _servo2_position;
 byte _servo2_target;
 bool _ledOn = false;
 char _password[PASSWORD_LENGTH];
-char _serialBuffer[BUFFER_SIZE];
-char _bleBuffer[BUFFER_SIZE];
+
+ISR(TIMER0_COMPB_vect) {
+  motion.tick();
+}
 
 void before() {
-  _servo1_position = loadState(EEPROM_SERVO1_POS);  // Set position to last known state (using eeprom storage)
-  _servo2_position = loadState(EEPROM_SERVO2_POS);  // Set position to last known state (using eeprom storage)
+  // Set position to last known state (using eeprom storage)
+  motion.add(SERVO1_PIN, SERVO_NO_POWER_PIN, loadState(EEPROM_SERVO1_POS));
+  motion.add(SERVO2_PIN, SERVO_NO_POWER_PIN, loadState(EEPROM_SERVO2_POS));
+  motion.setProfile(0, SERVO_SPEED, SERVO_ACCELERATION, SERVO_SETTLE);
+  motion.setProfile(1, SERVO_SPEED, SERVO_ACCELERATION, SERVO_SETTLE);
+  motion.onDone(onServoDone);
+  _servo1_target = motion.getPosition(0);
+  _servo2_target = motion.getPosition(1);
   _action = false;
 
   initPasswordValue();
 
+  bleCommand.addCommand(F("unlock"), onUnlockCommand);
+  bleCommand.addCommand(F("lock"), onLockCommand);
+  bleCommand.onData(sendStatusToBleDevice);
+
   pinMode(BLE_LINK_PIN, INPUT);
   pinMode(LED_PIN, OUTPUT);
 
@@ -108,127 +122,131 @@ void receive(const MyMessage &message) {
   }
 }
 
-inline void manageServo() {
-  if (_action && millis() - _timeOfLastChange > 5) {
-    // start servo 1
-    if (_servo1_target != _servo1_position && !_servo1.attached() && !_servo2.attached()) {
-      send(msgInfo.set(F("moving servo 1...")));
-      _servo1.attach(SERVO1_PIN);
+// Servo 1 moves first, then servo 2
+void onServoDone(byte index, byte position) {
+  if (index == 0) {
+    if (position == SERVO1_UNLOCK_POS) {
+      send(msgInfo.set(F("servo 1 unlocked")));
+    } else {
+      send(msgInfo.set(F("servo 1 locked")));
     }
 
-    // start servo 2
-    if (_servo2_target != _servo2_position && !_servo1.attached() && !_servo2.attached()) {
-      send(msgInfo.set(F("moving servo 2...")));
-      _servo2.attach(SERVO2_PIN);
+    // save in eeprom
+    if (loadState(EEPROM_SERVO1_POS) != position) {
+      saveState(EEPROM_SERVO1_POS, position);
+    }
+  } else {
+    if (position == SERVO2_UNLOCK_POS) {
+      send(msgInfo.set(F("servo 2 unlocked")));
+    } else {
+      send(msgInfo.set(F("servo 2 locked")));
     }
 
-    // Move servo 1
-    if (_servo1.attached()) {
-      if (_servo1_target > _servo1_position) {
-        _servo1_position++;
-        _servo1.write(_servo1_position);
-      } else if (_servo1_target < _servo1_position) {
-        _servo1_position--;
-        _servo1.write(_servo1_position);
-      } else {
-        if (_servo1_target == SERVO1_UNLOCK_POS) {
-          send(msgInfo.set(F("servo 1 unlocked")));
-        } else {
-          send(msgInfo.set(F("servo 1 locked")));
-        }
-
-        // save in eeprom
-        if (loadState(EEPROM_SERVO1_POS) != _servo1_target) {
-          saveState(EEPROM_SERVO1_POS, _servo1_target);
-        }
-
-        _servo1.detach();
-      }
-      // Move servo 2
-    } else if (_servo2.attached()) {
-      if (_servo2_target > _servo2_position) {
-        _servo2_position++;
-        _servo2.write(_servo2_position);
-      } else if (_servo2_target < _servo2_position) {
-        _servo2_position--;
-        _servo2.write(_servo2_position);
-      } else {
-        if (_servo2_target == SERVO2_UNLOCK_POS) {
-          send(msgInfo.set(F("servo 2 unlocked")));
-        } else {
-          send(msgInfo.set(F("servo 2 locked")));
-        }
-
-        // save in eeprom
-        if (loadState(EEPROM_SERVO2_POS) != _servo2_target) {
-          saveState(EEPROM_SERVO2_POS, _servo2_target);
-        }
-
-        _servo2.detach();
-      }
-    } else if (_servo1_target == _servo1_position && _servo2_target == _servo2_position) {
-      _action = false;
-
-      if (_servo1_target == SERVO1_UNLOCK_POS) {
-        powerOffLed();
-        send(msgInfo.set(F("Unlocked")));
-        send(msgLock.set(false));
-      } else {
-        powerOnLed();
-        send(msgInfo.set(F("Locked")));
-        send(msgLock.set(true));
-      }
+    // save in eeprom
+    if (loadState(EEPROM_SERVO2_POS) != position) {
+      saveState(EEPROM_SERVO2_POS, position);
     }
+  }
+
+  nextMove();
+}
+
+bool moveServo(byte index, byte target) {
+  if (motion.getPosition(index) == target) {
+    return false;
+  }
+
+  if (index == 0) {
+    send(msgInfo.set(F("moving servo 1...")));
+  } else {
+    send(msgInfo.set(F("moving servo 2...")));
+  }
+
+  motion.moveTo(index, target);
+  return true;
+}
+
+void startAction() {
+  _action = true;
+  powerOnLed();
+
+  // a running move ends in onServoDone() which picks up the new targets
+  if (!motion.isMoving()) {
+    nextMove();
+  }
+}
 
-    _timeOfLastChange = millis();
+void nextMove() {
+  if (!moveServo(0, _servo1_target) && !moveServo(1, _servo2_target)) {
+    endAction();
+  }
+}
+
+void endAction() {
+  _action = false;
+
+  if (_servo1_target == SERVO1_UNLOCK_POS) {
+    powerOffLed();
+    send(msgInfo.set(F("Unlocked")));
+    send(msgLock.set(false));
+  } else {
+    powerOnLed();
+    send(msgInfo.set(F("Locked")));
+    send(msgLock.set(true));
   }
 }
 
 void loop() {
-  if (bleDataAvailable()) {
+  if (bleCommand.process()) {
     Serial.print("ble: ");
-    Serial.println(_bleBuffer);
-
-    if (startWith(_bleBuffer, "cmd+unlock=")) {
-      if (equal(_bleBuffer + 11, _password)) {
-        unlock();
-        ble.println("status:unlock");
-        Serial.println("unlock");
-      } else {
-        ble.println("status:wrong password");
-      }
-    } else if (startWith(_bleBuffer, "cmd+lock=")) {
-      if (equal(_bleBuffer + 9, _password)) {
-        lock();
-        ble.println("status:lock");
-        Serial.println("lock");
-      } else {
-        ble.println("status:wrong password");
-      }
-    } else if (startWith(_bleBuffer, "cmd+data?")) {
-      if (isLocked()) {
-        ble.println("status:lock");
-      } else {
-        ble.println("status:unlock");
-      }
-    }
+    Serial.println(bleCommand.getLine());
   }
 
-  if (serialDataAvailable()) {
-    if (startWith(_serialBuffer, "password:")) {
-      savePassword(_serialBuffer + 9);
+  if (serialLine.read()) {
+    char *line = serialLine.getLine();
+
+    if (strncmp_P(line, PSTR("password:"), 9) == 0) {
+      savePassword(line + 9);
     } else {
-      Serial.println(_serialBuffer);
-      ble.write(_serialBuffer);
+      Serial.println(line);
+      ble.write(line);
     }
   }
 
-  manageServo();
+  motion.update();
   manageHeartbeat();
   manageLed();
   manageBleLink();
 }
 
+void onUnlockCommand(const char *password) {
+  if (strcmp(password, _password) == 0) {
+    unlock();
+    ble.println("status:unlock");
+    Serial.println("unlock");
+  } else {
+    ble.println("status:wrong password");
+  }
+}
+
+void onLockCommand(const char *password) {
+  if (strcmp(password, _password) == 0) {
+    lock();
+    ble.println("status:lock");
+    Serial.println("lock");
+  } else {
+    ble.println("status:wrong password");
+  }
+}
+
+void sendStatusToBleDevice() {
+  if (isLocked()) {
+    ble.println("status:lock");
+  } else {
+    ble.println("status:unlock");
+  }
+}
+
 inline void manageBleLink() {
   static bool linked = false;
   static unsigned long timer = 0;
@@ -300,21 +318,17 @@ void powerOffLed() {
 void unlock() {
   _servo1_target = SERVO1_UNLOCK_POS;
   _servo2_target = SERVO2_UNLOCK_POS;
-  _action = true;
-  powerOnLed();
-  _timeOfLastChange = millis();
+  startAction();
 }
 
 void lock() {
   _servo1_target = SERVO1_LOCK_POS;
   _servo2_target = SERVO2_LOCK_POS;
-  _action = true;
-  powerOnLed();
-  _timeOfLastChange = millis();
+  startAction();
 }
 
 bool isLocked() {
-  return _servo1_position == SERVO1_LOCK_POS && _servo2_target == SERVO2_LOCK_POS;
+  return motion.getPosition(0) == SERVO1_LOCK_POS && motion.getPosition(1) == SERVO2_LOCK_POS;
 }
 
 void initPasswordValue() {
@@ -344,79 +358,3 @@ void savePassword(const char *password) {
     Serial.println(_password);
   }
 }
-
-inline bool serialDataAvailable() {
-  if (Serial.available()) {
-    unsigned char cpt = 0;
-
-    while (Serial.available()) {
-      _serialBuffer[cpt] = Serial.read();
-
-      if (cpt > BUFFER_SIZE - 1 || _serialBuffer[cpt] == '\n') {
-        _serialBuffer[cpt] = 0;  // end string
-        break;
-      } else {
-        unsigned long timer = millis();
-        while (!Serial.available() && (millis() - timer < 1000));
-        cpt++;
-        _serialBuffer[cpt] = 0;  // end string
-      }
-    }
-
-    return true;
-  } else {
-    return false;
-  }
-}
-
-inline bool bleDataAvailable() {
-  if (ble.available()) {
-    unsigned char cpt = 0;
-
-    while (ble.available()) {
-      _bleBuffer[cpt] = ble.read();
-
-      if (cpt > BUFFER_SIZE - 1 || _bleBuffer[cpt] == '\n') {
-        _bleBuffer[cpt] = 0;  // end string
-        break;
-      } else {
-        unsigned long timer = millis();
-        while (!ble.available() && (millis() - timer < 1000));
-        cpt++;
-        _bleBuffer[cpt] = 0;  // end string
-      }
-    }
-
-    return true;
-  } else {
-    return false;
-  }
-}
-
-bool startWith(char *str, char *sfind) {
-  if (strlen(sfind) > strlen(str)) {
-    return false;
-  }
-
-  for (char i = 0; i < strlen(sfind); i++) {
-    if (str[i] != sfind[i]) {
-      return false;
-    }
-  }
-
-  return true;
-}
-
-bool equal(char *str, char *sfind) {
-  if (strlen(sfind) != strlen(str)) {
-    return false;
-  }
-
-  for (char i = 0; i < strlen(sfind); i++) {
-    if (str[i] != sfind[i]) {
-      return false;
-    }
-  }
-
-  return true;
-}
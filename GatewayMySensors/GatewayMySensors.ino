@@ -22,10 +22,39 @@
 #define MY_RX_MESSAGE_BUFFER_SIZE (8)
 
 #include <MySensors.h>
+#include <RelayHeader.h>
+#include <TelemetryFrame.h>
+
+// Child ID
+#define CHILD_ID_RELAY 0
+#define CHILD_ID_STATS 1
+
+// Statistics
+#define STATS_MAX_NODES 24
+#define STATS_LATENCY_BUCKETS 13      // log2 buckets of relay latency in ms (0, 1, 2-3, 4-7 ... 2048-4095)
+#define STATS_DUPLICATE_WINDOW 1000UL // same message from same node within this delay is a duplicate
+
+struct NodeStats {
+  byte nodeId;
+  byte lastSensor;
+  byte lastType;
+  byte lastChecksum;
+  unsigned long lastTime;
+  uint16_t received;
+  uint16_t duplicate;
+  uint16_t relayed;
+  uint16_t failed;
+};
+
+NodeStats _nodeStats[STATS_MAX_NODES];
+byte _nodeStatsCount = 0;
+uint16_t _relayLatency[STATS_LATENCY_BUCKETS];
+byte _rxBufferMax = 0;
 
 MyMessage msgToRelay;
 unsigned long relayTimer = 0;
-MyMessage msg(0, V_CUSTOM);
+MyMessage msg(CHILD_ID_RELAY, V_CUSTOM);
+MyMessage msgExpanded;
 
 void setup()
 {
@@ -39,26 +68,43 @@ void presentation()
 
 void receive(const MyMessage &message)
 {
-  if (message.type == V_CUSTOM && message.sensor == 0 && message.sender == 0) {
+  updateRxBufferMax();
+
+  if (message.sender != 0) {
+    countReceived(&message);
+
+    if (message.type == V_CUSTOM && message.sensor == TELEMETRY_CHILD_ID) {
+      expandTelemetry(&message);
+    }
+  } else if (message.type == V_CUSTOM && message.sensor == CHILD_ID_RELAY) {
     relayMessage(&message);
+  } else if (message.type == V_CUSTOM && message.sensor == CHILD_ID_STATS) {
+    if (strcmp(message.getString(), "reset") == 0) {
+      resetStats();
+    }
+
+    sendStats();
   }
 }
 
 void loop()
 {
+  updateRxBufferMax();
   wait(5);
 }
 
 void relayMessage(const MyMessage *message) {
-  if (getPayload(message->getString()) != NULL) {
-      msgToRelay.destination = getMessagePart(message->getString(), 0);
-      msgToRelay.sensor = getMessagePart(message->getString(), 1);
-      mSetCommand(msgToRelay, getMessagePart(message->getString(), 2));
-      mSetRequestAck(msgToRelay, getMessagePart(message->getString(), 3));
-      msgToRelay.type = getMessagePart(message->getString(), 4);
+  RelayHeader header;
+
+  if (parseRelayHeader(message->getString(), &header)) {
+      msgToRelay.destination = header.destination;
+      msgToRelay.sensor = header.sensor;
+      mSetCommand(msgToRelay, header.command);
+      mSetRequestAck(msgToRelay, header.requestAck);
+      msgToRelay.type = header.type;
       msgToRelay.sender = message->sender;
       mSetAck(msgToRelay, false);
-      msgToRelay.set(getPayload(message->getString()));
+      msgToRelay.set(header.payload);
 
       relayTimer = millis();
       bool success = false;
@@ -67,6 +113,8 @@ void relayMessage(const MyMessage *message) {
         wait(5);
       }
 
+      countRelayed(msgToRelay.destination, success, millis() - relayTimer);
+
       if (success) {
         send(msg.set(F("SUCCESS")));
       } else {
@@ -75,38 +123,164 @@ void relayMessage(const MyMessage *message) {
     }
 }
 
-int getMessagePart(const char* message, const byte index) {
-  byte indexCount = 0;
+// Forward each value of a packed frame to the controller as if the node had sent it alone
+void expandTelemetry(const MyMessage *message) {
+  TelemetryFrame frame;
+
+  if (!frame.decode(message->getCustom(), mGetLength(*message))) {
+    return;
+  }
+
+  for (byte i = 0; i < frame.getCount(); i++) {
+    TelemetryValue value = frame.getValue(i);
+    build(msgExpanded, GATEWAY_ADDRESS, value.sensor, C_SET, value.type);
+
+    if (value.decimals == 0) {
+      msgExpanded.set(value.value);
+    } else {
+      float divisor = 1.0;
+      for (byte d = 0; d < value.decimals; d++) {
+        divisor *= 10.0;
+      }
+      msgExpanded.set(value.value / divisor, value.decimals);
+    }
+
+    sendExpanded(message->sender, msgExpanded);
+  }
+
+  if (frame.getBatteryPercent() != TELEMETRY_NO_BATTERY) {
+    build(msgExpanded, GATEWAY_ADDRESS, NODE_SENSOR_ID, C_INTERNAL, I_BATTERY_LEVEL);
+    sendExpanded(message->sender, msgExpanded.set(frame.getBatteryPercent()));
+  }
+
+  if (frame.getBatteryMillivolts() != 0) {
+    build(msgExpanded, GATEWAY_ADDRESS, TELEMETRY_CHILD_ID, C_SET, V_VOLTAGE);
+    sendExpanded(message->sender, msgExpanded.set(frame.getBatteryMillivolts() / 1000.0, 3));
+  }
+}
+
+void sendExpanded(const byte sender, MyMessage &message) {
+  message.sender = sender;
+  gatewayTransportSend(message);
+}
+
+NodeStats* getNodeStats(const byte nodeId) {
+  for (byte i = 0; i < _nodeStatsCount; i++) {
+    if (_nodeStats[i].nodeId == nodeId) {
+      return &_nodeStats[i];
+    }
+  }
+
+  if (_nodeStatsCount < STATS_MAX_NODES) {
+    NodeStats* stats = &_nodeStats[_nodeStatsCount++];
+    memset(stats, 0, sizeof(NodeStats));
+    stats->nodeId = nodeId;
+    return stats;
+  }
+
+  return NULL;
+}
+
+void countReceived(const MyMessage *message) {
+  NodeStats* stats = getNodeStats(message->sender);
+
+  if (stats == NULL) {
+    return;
+  }
+
+  byte checksum = 0;
+  const uint8_t* payload = (const uint8_t*)message->getCustom();
+
+  for (byte i = 0; i < mGetLength(*message); i++) {
+    checksum = (checksum << 1 | checksum >> 7) ^ payload[i];
+  }
+
+  if (stats->received > 0 && stats->lastSensor == message->sensor && stats->lastType == message->type &&
+      stats->lastChecksum == checksum && millis() - stats->lastTime < STATS_DUPLICATE_WINDOW) {
+    if (stats->duplicate < 0xFFFF) {
+      stats->duplicate++;
+    }
+  }
+
+  if (stats->received < 0xFFFF) {
+    stats->received++;
+  }
+
+  stats->lastSensor = message->sensor;
+  stats->lastType = message->type;
+  stats->lastChecksum = checksum;
+  stats->lastTime = millis();
+}
+
+void countRelayed(const byte nodeId, const bool success, unsigned long latency) {
+  NodeStats* stats = getNodeStats(nodeId);
 
-  if (index == 0 && strlen(message) > 0) {
-    return atoi(message);
+  if (stats != NULL) {
+    if (success && stats->relayed < 0xFFFF) {
+      stats->relayed++;
+    } else if (!success && stats->failed < 0xFFFF) {
+      stats->failed++;
+    }
   }
-  
-  for (byte i=0; i < strlen(message) - 1; i++) {
-    if (message[i] == '-') {
-      indexCount++;
+
+  if (success) {
+    byte bucket = 0;
+
+    while (latency > 0 && bucket < STATS_LATENCY_BUCKETS - 1) {
+      latency >>= 1;
+      bucket++;
     }
 
-    if (indexCount == index) {
-      return atoi(message + i + 1);
+    if (_relayLatency[bucket] < 0xFFFF) {
+      _relayLatency[bucket]++;
     }
   }
+}
+
+inline void updateRxBufferMax() {
+#if defined(MY_RX_MESSAGE_BUFFER_FEATURE)
+  byte count = transportRxQueue.available();
+
+  if (count > _rxBufferMax) {
+    _rxBufferMax = count;
+  }
+#endif
+}
 
-  return 0;
+void resetStats() {
+  _nodeStatsCount = 0;
+  _rxBufferMax = 0;
+  memset(_relayLatency, 0, sizeof(_relayLatency));
 }
 
-char* getPayload(const char* message) {
-  byte indexCount = 0;
-  
-  for (byte i=0; i < strlen(message) - 1; i++) {
-    if (message[i] == '-') {
-      indexCount++;
+void sendStatsLine(const char *line) {
+  gatewayTransportSend(build(_msgTmp, GATEWAY_ADDRESS, CHILD_ID_STATS, C_INTERNAL, I_LOG_MESSAGE).set(line));
+}
+
+void sendStats() {
+  char line[MAX_PAYLOAD + 1];
+
+  for (byte i = 0; i < _nodeStatsCount; i++) {
+    NodeStats* stats = &_nodeStats[i];
+
+    if (stats->received > 0) {
+      snprintf_P(line, sizeof(line), PSTR("%u rx%u dup%u"), stats->nodeId, stats->received, stats->duplicate);
+      sendStatsLine(line);
     }
 
-    if (indexCount == 5) {
-      return message + i + 1;
+    if (stats->relayed > 0 || stats->failed > 0) {
+      snprintf_P(line, sizeof(line), PSTR("%u rl%u ko%u"), stats->nodeId, stats->relayed, stats->failed);
+      sendStatsLine(line);
     }
   }
 
-  return NULL;
+  for (byte i = 0; i < STATS_LATENCY_BUCKETS; i++) {
+    if (_relayLatency[i] > 0) {
+      snprintf_P(line, sizeof(line), PSTR("lat<%ums %u"), 1U << i, _relayLatency[i]);
+      sendStatsLine(line);
+    }
+  }
+
+  snprintf_P(line, sizeof(line), PSTR("rxbuf %u/%u"), _rxBufferMax, MY_RX_MESSAGE_BUFFER_SIZE);
+  sendStatsLine(line);
 }
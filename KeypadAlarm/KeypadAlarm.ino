@@ -31,7 +31,7 @@
 
 // Includes
 #include <MySensors.h>
-#include <Keypad.h>
+#include <KeypadScanner.h>
 #include <Vcc.h>
 
 // Battery report
@@ -55,7 +55,16 @@ char _keys[_rows][_cols] = {
 };
 byte _rowPins[_rows] = {8, 7, 4, 3}; //connect to the row pinouts of the keypad
 byte _colPins[_cols] = {A0, A1, A2}; //connect to the column pinouts of the keypad
-Keypad _keypad = Keypad(makeKeymap(_keys), _rowPins, _colPins, _rows, _cols);
+KeypadScanner _keypad((const char *)_keys, _rowPins, _colPins, _rows, _cols);
+
+// rows on port B and port D
+ISR(PCINT0_vect) {
+  _keypad.handleInterrupt();
+}
+
+ISR(PCINT2_vect) {
+  _keypad.handleInterrupt();
+}
 
 // State
 enum State_enum {NOMINAL, CHANGE_PASSWORD, CHECK_PASSWORD};
@@ -70,6 +79,7 @@ void before()
   pinMode(GREEN_LED, OUTPUT);
   pinMode(RED_LED, OUTPUT);
   pinMode(BELL, INPUT);
+  _keypad.begin();
   digitalWrite(BUZZER, LOW);
   digitalWrite(GREEN_LED, LOW);
   digitalWrite(RED_LED, HIGH);
@@ -99,7 +109,7 @@ void loop() {
   char key = _keypad.getKey();
 
   // key pressed
-  if (key != NO_KEY) {
+  if (key != KEYPAD_NO_KEY) {
     DEBUG_PRINT(F("Key pressed:"));
     DEBUG_PRINT(key);
     _keyboardInterruptTime = millis();
@@ -177,18 +187,18 @@ void loop() {
     }
   }
 
-  if (millis() - _keyboardInterruptTime >= 10000) {
-    // Sleep until key 0 is pressed
+  if (millis() - _keyboardInterruptTime >= 10000 && _keypad.isIdle()) {
+    // Sleep until a key is pressed, the key is read by the next getKey()
     _state = NOMINAL;
+    _keyboardPosition = 0;
     digitalWrite(GREEN_LED, LOW);
     digitalWrite(RED_LED, LOW);
     reportBatteryLevel();
-    putKeypadToInterruptMode();
+    _keypad.prepareSleep();
     sleep(digitalPinToInterrupt(_rowPins[_rows - 1]), FALLING, 0);
-    _keyboardPosition = 1;
     _keyboardInterruptTime = millis();
   } else {
-    wait(10);
+    wait(1);
   }
 }
 
@@ -198,15 +208,6 @@ void buzz(int duration) {
   digitalWrite(BUZZER, LOW);
 }
 
-void putKeypadToInterruptMode() {
-  for (char i = 0; i < _cols; i++) {
-    pinMode(_colPins[i], OUTPUT);
-    digitalWrite(_colPins[i], LOW);
-  }
-
-  pinMode(_rowPins[_rows - 1], INPUT_PULLUP);
-}
-
 void initPasswordValue() {
   if (isAscii(loadState(0))) {
     for (char i = 0; i < strlen(_password); i++) {
@@ -15,6 +15,7 @@
 #endif
 
 #include <MySensors.h>
+#include <ChangeReporter.h>
 
 #define PIN_PHOTOCELL A3
 #define PIN_ALIM_PHOTOCELL A5
@@ -28,12 +29,22 @@ const float _vccCorrection = 1.0;      // Measured Vcc by multimeter divided by
 static Vcc _vcc(_vccCorrection);
 #endif
 
-int lastPhotocell = -100;
+#define EEPROM_LIGHT_REPORT EEPROM_LOCAL_CONFIG_ADDRESS + 0
+
+// dead-band, relative band, hysteresis, rate per hour, heartbeat in minutes
+ChangeReporter lightReporter({5, REPORT_OFF, REPORT_OFF, REPORT_OFF, 60});
 
 MyMessage msgLight(0, V_LIGHT_LEVEL);
 
 void setup() {
   pinMode(PIN_PHOTOCELL, INPUT);
+  lightReporter.begin(EEPROM_LIGHT_REPORT);
+}
+
+void receive(const MyMessage &message) {
+  if (message.sensor == 0 && message.type == V_CUSTOM) {
+    lightReporter.configure(message.getString());
+  }
 }
 
 void presentation() {
@@ -48,14 +59,16 @@ void loop() {
   DEBUG_PRINT(F("Light: "));
   DEBUG_PRINT(photocell);
 
-  int diff = photocell - lastPhotocell;
-  if (abs(diff) > 5) { 
-    send(msgLight.set(photocell));
-    lastPhotocell = photocell;
+  if (lightReporter.update(photocell, 1) && send(msgLight.set(photocell))) {
+    lightReporter.markReported();
   }
 
   reportBatteryLevel();
   sendHeartbeat();
+
+  // listen a moment so a report configuration sent by the controller gets in
+  RF24_startListening();
+  wait(15);
   sleep(60000);
 }
 
@@ -10,16 +10,39 @@
 #include <MySensors.h>
 #include <BH1750.h>
 #include <Wire.h>
+#include <ChangeReporter.h>
+#include <SendQueue.h>
+
+#define EEPROM_LUX_REPORT EEPROM_LOCAL_CONFIG_ADDRESS + 0
 
 BH1750 lightSensor;
 MyMessage msg(0, V_LEVEL);
-uint16_t lastlux = 65535;
 int heartbeatCpt = 0;
+SendQueue sendQueue;
+
+// lux bands reported when crossed
+const long LUX_BANDS[] PROGMEM = {1, 3, 5, 10, 25, 50, 100, 500};
+
+// dead-band, relative band, hysteresis, rate per hour, heartbeat in minutes
+ChangeReporter luxReporter({REPORT_OFF, REPORT_OFF, 1, REPORT_OFF, 120});
 
 void setup() {
   heartbeatCpt = 0;
   Wire.begin();
   lightSensor.begin(BH1750::ONE_TIME_HIGH_RES_MODE);
+  lightSensor.setAutoRange(true); // keep resolution in the dark and avoid saturation
+  luxReporter.setBands(LUX_BANDS, sizeof(LUX_BANDS) / sizeof(LUX_BANDS[0]));
+  luxReporter.begin(EEPROM_LUX_REPORT);
+}
+
+void receive(const MyMessage &message) {
+  if (sendQueue.receive(message)) {
+    return;
+  }
+
+  if (message.sensor == 0 && message.type == V_CUSTOM) {
+    luxReporter.configure(message.getString());
+  }
 }
 
 void presentation() {
@@ -28,32 +51,15 @@ void presentation() {
 }
 
 void loop() {
-  while (!lightSensor.measurementReady(true)) {
-    yield();
-  }
-  
+  // Sleep during the integration time of the MTreg in use
+  sleep(lightSensor.measurementTime(true));
+
   uint16_t lux = lightSensor.readLightLevel(); // Get Lux value
   DEBUG_PRINT(lux);
-  bool hasChanged = false;
-
-  if (lux >= 500) {
-    hasChanged = lastlux < 500;                  // lux > 500
-  } else if (lux >= 100) {
-    hasChanged = lastlux > 500 || lastlux < 100; // lux > 100
-  } else if (lux >= 50) {
-    hasChanged = lastlux > 100 || lastlux < 50;  // lux > 50
-  } else if (lux >= 25) {
-    hasChanged = lastlux > 50 || lastlux < 25;   // lux > 25
-  } else if (lux >= 10) {
-    hasChanged = lastlux > 25 || lastlux < 10;   // lux > 10
-  } else {
-    hasChanged = lux != lastlux;                 // lux > 0
-  }
-
-  lastlux = lux;
 
-  if (hasChanged) {
-    sendWithRetry(msg.set(lux), 10);
+  if (luxReporter.update(lux, 1)) {
+    sendQueue.push(msg.set(lux));
+    luxReporter.markReported();
   }
 
   if (heartbeatCpt > 50) {
@@ -61,31 +67,12 @@ void loop() {
     heartbeatCpt = 0;
   }
 
+  sendQueue.flush();
+
+  // listen a moment so a report configuration sent by the controller gets in
+  RF24_startListening();
+  wait(15);
   sleep(60000);  // 1 minute
   heartbeatCpt++;
-  lightSensor.configure(BH1750::ONE_TIME_HIGH_RES_MODE);
-}
-
-void sendWithRetry(MyMessage &message, const byte retryNumber) {
-  byte counter = retryNumber;
-  bool success = false;
-
-  do {
-    DEBUG_PRINT("send message");
-    success = send(message, true);
-
-    if (success) {
-      success = wait(500, message.getCommand(), message.type);
-
-      if (!success) {
-        DEBUG_PRINT("no software ACK");
-      }
-    } else {
-      DEBUG_PRINT("no hardware ACK");
-    }
-
-    if (!success && counter != 0 && (retryNumber - counter) > 0) {
-      sleep(500 * (retryNumber - counter));
-    }
-  } while (!success && counter--);
+  lightSensor.startMeasurement(BH1750::ONE_TIME_HIGH_RES_MODE);
 }
@@ -3,7 +3,7 @@
 #include <SoftwareSerial.h>
 #include <FastLED.h>
 #include <DFRobotDFPlayerMini.h>
-#include <AccelStepper.h>
+#include <BleCommand.h>
 
 #define BLE_RX_PIN 5
 #define BLE_TX_PIN 6
@@ -19,12 +19,13 @@
 #define MOTOR_IN2_PIN 11
 #define MOTOR_IN3_PIN 12
 #define MOTOR_IN4_PIN 13
-#define MOTOR_INTERFACE_TYPE 8
+#define MOTOR_TICKS_PER_SECOND (F_CPU / 256)  // timer 1 with prescaler 256
 
 #define BUTTON_PIN 3
 #define LED_PIN 9
 
 #define NUM_LEDS 10
+#define LED_SHOW_TICKS ((NUM_LEDS * 30UL + 50) * MOTOR_TICKS_PER_SECOND / 1000000UL)  // 30 us per led plus reset
 
 #define EEPROM_COLOR 0       // 3 byte
 #define EEPROM_VOLUME 4      // 1 byte
@@ -34,13 +35,18 @@
 #define EEPROM_BLE_TIMER 11  // 1 byte
 
 SoftwareSerial ble(BLE_TX_PIN, BLE_RX_PIN);
+BleCommand bleCommand(ble);
 
 CRGB leds[NUM_LEDS];
 
 SoftwareSerial dfPlayerSerial(DFPLAYER_TX_PIN, DFPLAYER_RX_PIN);
 DFRobotDFPlayerMini dfPlayer;
 
-AccelStepper motor = AccelStepper(MOTOR_INTERFACE_TYPE, MOTOR_IN1_PIN, MOTOR_IN3_PIN, MOTOR_IN2_PIN, MOTOR_IN4_PIN);
+volatile uint8_t *_motorPort;
+uint8_t _motorMask;
+uint8_t _motorPhases[8];
+volatile byte _motorPhase = 0;
+byte _motorDirection = 1;
 
 enum State_enum {STOPPED, LIGHT, ANIMATION};
 
@@ -48,12 +54,12 @@ byte _volume;
 uint8_t _state = STOPPED;
 byte _color[3];
 int _motorSpeed;
-unsigned long _bleTimer;
+byte _bleTimer;
 
 unsigned long _startTime = 0;
-unsigned long _timer;
+byte _timer;
 
-int _music = 0;
+byte _music = 0;
 unsigned long _animationTimer = 0;
 byte _fadeLight = 0;
 boolean _fadeLightReverse = false;
@@ -77,6 +83,7 @@ void setup() {
   ble.begin(9600);
 
   FastLED.addLeds<WS2812, LED_PIN, GRB>(leds, NUM_LEDS);
+  initMotor();
 
   dfPlayerSerial.begin(9600);
 
@@ -89,12 +96,19 @@ void setup() {
 
   Serial.println(F("DFPlayer Mini online"));
 
-  _volume = getVolume();
-  _music = getMusic();
-  _timer = getTimer();
-  _motorSpeed = getMotorSpeed();
-  _bleTimer = getBleTimer();
-  readColor();
+  bleCommand.addCommand(F("start"), onModeCommand);
+  bleCommand.addCommand(F("stop"), onModeCommand);
+  bleCommand.addCommand(F("color"), onColorCommand);
+  bleCommand.addCommand(F("savecolor"), onSaveColorCommand);
+  bleCommand.addCommand(F("name"), onNameCommand);
+  bleCommand.addColor(F("color"), _color, EEPROM_COLOR, onColorSaved);
+  bleCommand.addByte(F("volume"), &_volume, EEPROM_VOLUME, 0, 100, 30, onVolumeChanged);
+  bleCommand.addByte(F("music"), &_music, EEPROM_MUSIC, 1, 254, 1, onMusicChanged);
+  bleCommand.addByte(F("timer"), &_timer, EEPROM_TIMER, 0, 254, 10);
+  bleCommand.addInt(F("motor"), &_motorSpeed, EEPROM_MOTOR_SPEED, 0, 1000, 0, onMotorSpeedChanged);
+  bleCommand.addByte(F("ble"), &_bleTimer, EEPROM_BLE_TIMER, 0, 254, 0);
+  bleCommand.onData(sendStatusToBleDevice);
+  bleCommand.load();
 
   Serial.println("Volume: " + String(_volume));
   Serial.println("Music: " + String(_music));
@@ -102,25 +116,22 @@ void setup() {
   Serial.println("Motor Speed: " + String(_motorSpeed));
   Serial.println("Ble Timer: " + String(_bleTimer) + " minutes");
 
-  motor.setMaxSpeed(1000);
-  motor.setSpeed(_motorSpeed);
-
   changeVolume(_volume);
 
   for (int i = 0; i < NUM_LEDS; i++) {
     leds[i] = CRGB ( 0, 0, 255);
-    FastLED.show();
+    showLeds();
   }
 
   delay(500);
 
   for (int i = (NUM_LEDS - 1) ; i >= 0; i--) {
     leds[i] = CRGB (0, 0, 0);
-    FastLED.show();
+    showLeds();
   }
 
   if (digitalRead(BLE_LINK_PIN) == HIGH) {
-    sendDataToBleDevice();
+    bleCommand.sendData();
   }
   
   turnOnAdvertising();
@@ -130,83 +141,9 @@ void setup() {
 void loop() {
   ble.listen();
 
-  while (ble.available()) {
-    String msg = ble.readStringUntil('\n');
-    Serial.println("ble: " + msg);
-
-    if (msg == "cmd+start") {
-      changeMode();
-      if (_state != STOPPED) {
-        ble.println("status:on");
-      } else {
-        ble.println("status:off");
-      }
-    } else if (msg == "cmd+stop") {
-      changeMode();
-      if (_state != STOPPED) {
-        ble.println("status:on");
-      } else {
-        ble.println("status:off");
-      }
-    } else if (msg == "cmd+data?") {
-      sendDataToBleDevice();
-    } else if (msg.startsWith("cmd+color=")) {
-      String color = parseCommand(msg, '=', 1);
-      displayColor(color);
-    } else if (msg.startsWith("cmd+savecolor=")) {
-      String color = parseCommand(msg, '=', 1);
-      displayColor(color);
-      saveColor();
-      Serial.println("Color saved: " + color);
-      ble.println("color:" + color);
-    } else if (msg.startsWith("cmd+volume=")) {
-      byte volume = parseCommand(msg, '=', 1).toInt();
-      saveVolume(volume);
-      Serial.println("Volume: " + String(volume));
-      ble.println("volume:" + String(volume));
-      changeVolume(volume);
-    } else if (msg.startsWith("cmd+music=")) {
-      byte music = parseCommand(msg, '=', 1).toInt();
-
-      if (music >= 1 && music <= 255) {
-        saveMusic(music);
-        _music = music;
-        Serial.println("Music: " + String(music));
-        ble.println("music:" + String(music));
-
-        if (_state != STOPPED) {
-          stopAnimationMode();
-          startAnimationMode();
-        }
-      }
-    } else if (msg.startsWith("cmd+timer=")) {
-      byte timer = parseCommand(msg, '=', 1).toInt();
-      saveTimer(timer);
-      Serial.println("Timer: " + String(timer));
-      ble.println("timer:" + String(timer));
-    } else if (msg.startsWith("cmd+motor=")) {
-      int motorSpeed = parseCommand(msg, '=', 1).toInt();
-
-      if (motorSpeed >= 0 && motorSpeed < 1001) {
-        saveMotorSpeed(motorSpeed);
-        motor.setSpeed(motorSpeed);
-        Serial.println("Motor Speed: " + String(motorSpeed));
-        ble.println("motor:" + String(motorSpeed));
-      }
-    } else if (msg.startsWith("cmd+ble=")) {
-      byte bleTimer = parseCommand(msg, '=', 1).toInt();
-      saveBleTimer(bleTimer);
-      Serial.println("Ble Timer: " + String(bleTimer));
-      ble.println("ble:" + String(bleTimer));
-    } else if (msg.startsWith("cmd+name=")) {
-      String name = parseCommand(msg, '=', 1);
-      Serial.println("Name: " + String(name));
-      ble.print("+++");
-      delay(500);
-      ble.print("AT+NAME=[omc] " + name);
-      delay(500);
-      ble.print("AT+EXIT");
-    }
+  if (bleCommand.process()) {
+    Serial.print(F("ble: "));
+    Serial.println(bleCommand.getLine());
   }
 
   if (Serial.available() > 0) {
@@ -237,11 +174,9 @@ void loop() {
         _fadeLightReverse = !_fadeLightReverse;
       }
 
-      FastLED.show();
+      showLeds();
     }
 
-    motor.runSpeed();
-
     if ( (_timer != 0 && millis() - _startTime >= _timer * 60000UL)) {
       stopAnimationMode();
     }
@@ -251,13 +186,13 @@ void loop() {
     changeMode();
 
     if (digitalRead(BLE_LINK_PIN) == HIGH) {
-      sendDataToBleDevice();
+      bleCommand.sendData();
     }
 
     delay(500);
   }
   
-  if (_bleStopTimerRunning && millis() - _bleStopTimer >= _bleTimer * 60000) {
+  if (_bleStopTimerRunning && millis() - _bleStopTimer >= _bleTimer * 60000UL) {
     Serial.println(F("Ble timer reached"));
     turnOffAdvertising();
     _bleStopTimerRunning = false;
@@ -284,7 +219,8 @@ void startAnimationMode() {
 
   leds[0].fadeLightBy(250);
 
-  FastLED.show();
+  showLeds();
+  startMotor(_motorSpeed);
 
   _animationTimer = 0;
   _startTime = millis();
@@ -297,15 +233,14 @@ void startAnimationMode() {
 
 void stopAnimationMode() {
   dfPlayer.stop();
+  stopMotor();
 
   for (int i = (NUM_LEDS - 1) ; i >= 0; i--) {
     leds[i] = CRGB (0, 0, 0);
-    FastLED.show();
+    showLeds();
     delay(10);
   }
 
-  motor.disableOutputs();
-
   _state = STOPPED;
   
   Serial.println(F("Animation mode stopped"));
@@ -318,7 +253,7 @@ void startLightMode() {
 
   leds[0] = CRGB (0, 0, 0);
 
-  FastLED.show();
+  showLeds();
 
   _animationTimer = 0;
   _startTime = millis();
@@ -330,7 +265,7 @@ void startLightMode() {
 void stopLightMode() {
   for (int i = (NUM_LEDS - 1) ; i >= 0; i--) {
     leds[i] = CRGB (0, 0, 0);
-    FastLED.show();
+    showLeds();
     delay(10);
   }
   
@@ -339,194 +274,179 @@ void stopLightMode() {
   Serial.println(F("Light mode stopped"));
 }
 
-void changeVolume(byte volume) {
-  byte a = map(volume, 0, 100, 0, 30);
-  dfPlayer.volume(a);
-}
-
-void sendDataToBleDevice() {
-  String status = _state == STOPPED ? "off" : "on";
-  String hexstring = "";
+void initMotor() {
+  const byte pins[] = {MOTOR_IN1_PIN, MOTOR_IN2_PIN, MOTOR_IN3_PIN, MOTOR_IN4_PIN};
+  byte coils[4];
 
-  for (int i = 0; i < 3; i++) {
-    if (_color[i] < 16) {
-      hexstring += "0" + String(_color[i], HEX);
-    } else {
-      hexstring += String(_color[i], HEX);
-    }
+  // the four coils are on the same port and written at once
+  for (byte i = 0; i < 4; i++) {
+    pinMode(pins[i], OUTPUT);
+    coils[i] = digitalPinToBitMask(pins[i]);
   }
 
-  ble.println("status:" + status);
-  ble.println("color:" + hexstring);
-  ble.println("volume:" + String(_volume));
-  ble.println("music:" + String(_music));
-  ble.println("timer:" + String(_timer));
-  ble.println("motor:" + String(_motorSpeed));
-  ble.println("ble:" + String(_bleTimer));
-}
+  _motorPort = portOutputRegister(digitalPinToPort(MOTOR_IN1_PIN));
+  _motorMask = coils[0] | coils[1] | coils[2] | coils[3];
 
-void startBleStopTimer() {
-  if (_bleTimer > 0) {
-    _bleStopTimer = millis();
-    _bleStopTimerRunning = true;
-    Serial.println(F("Ble timer started"));
+  // half steps: one coil, then it and the next one
+  for (byte i = 0; i < 8; i++) {
+    _motorPhases[i] = coils[i / 2] | (i % 2 ? coils[(i / 2 + 1) % 4] : 0);
   }
-}
-
-void stopBleStopTimer() {
-  _bleStopTimerRunning = false;
-  Serial.println(F("Ble timer stopped"));
-}
 
-void turnOnAdvertising() {
-  ble.print("AT+ADV=1");
-  delay(50);
-  ble.print("AT+RESET");
-  Serial.println(F("Advertising on"));
+  // timer 1 in CTC mode, the step interval is in OCR1A
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS12);
+  interrupts();
 }
 
-void turnOffAdvertising() {
-  ble.print("+++");
-  delay(50);
-  ble.print("AT+DISCON=0");
-  delay(50);
-  ble.print("AT+DISCON=1");
-  delay(50);
-  ble.print("AT+ADV=0");
-  delay(50);
-  ble.print("AT+EXIT");
-  delay(50);
-  Serial.println(F("Advertising off"));
-}
-
-void displayColor(String color) {
-  if (color.length() != 6) {
-    Serial.println("Color not valid!");
+// speed in steps per second, negative to turn backward
+void startMotor(int speed) {
+  if (speed == 0) {
+    stopMotor();
+    return;
   }
 
-  char firstByte[3];
-  color.substring(0, 2).toCharArray(firstByte, 3);
-  _color[0] = (byte) strtol(firstByte, NULL, 16);
+  unsigned long interval = min(MOTOR_TICKS_PER_SECOND / abs(speed), 65536UL);
 
-  color.substring(2, 4).toCharArray(firstByte, 3);
-  _color[1] = (byte) strtol(firstByte, NULL, 16);
+  noInterrupts();
+  _motorDirection = speed > 0 ? 1 : 7;
+  OCR1A = interval - 1;
 
-  color.substring(4, 6).toCharArray(firstByte, 3);
-  _color[2] = (byte) strtol(firstByte, NULL, 16);
-
-  for (int i = 0; i < NUM_LEDS; i++) {
-    leds[i] = CRGB (_color[0], _color[1], _color[2]);
+  if (!(TIMSK1 & _BV(OCIE1A))) {
+    TCNT1 = 0;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 |= _BV(OCIE1A);
+  } else if (TCNT1 >= OCR1A) {
+    TCNT1 = 0;
   }
-
-  FastLED.show();
+  interrupts();
 }
 
-void readColor() {
-  _color[0] = EEPROM.read(EEPROM_COLOR);
-  _color[1] = EEPROM.read(EEPROM_COLOR + 1);
-  _color[2] = EEPROM.read(EEPROM_COLOR + 2);
+void stopMotor() {
+  noInterrupts();
+  TIMSK1 &= ~_BV(OCIE1A);
+  *_motorPort &= ~_motorMask;
+  interrupts();
 }
 
-byte getVolume() {
-  byte result = EEPROM.read(EEPROM_VOLUME);
+ISR(TIMER1_COMPA_vect) {
+  _motorPhase = (_motorPhase + _motorDirection) & 7;
+  *_motorPort = (*_motorPort & ~_motorMask) | _motorPhases[_motorPhase];
+}
 
-  if (result == 255) {
-    result = 30;
+// FastLED.show() keeps the interrupts off while it writes the strip, so it
+// waits for a gap between two steps long enough for the whole strip
+void showLeds() {
+  if ((TIMSK1 & _BV(OCIE1A)) && OCR1A > LED_SHOW_TICKS) {
+    while ((uint16_t)(OCR1A - TCNT1) < LED_SHOW_TICKS);
   }
 
-  return result;
+  FastLED.show();
 }
 
-byte getMusic() {
-  byte result = EEPROM.read(EEPROM_MUSIC);
-
-  if (result == 255) {
-    result = 1;
-  }
+void changeVolume(byte volume) {
+  byte a = map(volume, 0, 100, 0, 30);
+  dfPlayer.volume(a);
+}
 
-  return result;
+void sendStatusToBleDevice() {
+  String status = _state == STOPPED ? "off" : "on";
+  ble.println("status:" + status);
 }
 
-byte getTimer() {
-  byte result = EEPROM.read(EEPROM_TIMER);
+// start and stop both go to the next mode
+void onModeCommand(const char *value) {
+  changeMode();
+  sendStatusToBleDevice();
+}
 
-  if (result == 255) {
-    result = 10;
+// preview, the color is saved by savecolor
+void onColorCommand(const char *value) {
+  if (BleCommand::parseColor(value, _color)) {
+    displayColor();
+  } else {
+    Serial.println("Color not valid!");
   }
-
-  return result;
 }
 
-int getMotorSpeed() {
- int value = 0.0;
- byte *b = (byte *)&value;
-
- for (byte i = 0; i < sizeof(value); i++) {
-  *b++ = EEPROM.read(EEPROM_MOTOR_SPEED + i);
- }
+void onSaveColorCommand(const char *value) {
+  if (!bleCommand.set("color", value)) {
+    Serial.println("Color not valid!");
+  }
+}
 
- return value;
+void onColorSaved(const char *value) {
+  displayColor();
+  Serial.print(F("Color saved: "));
+  Serial.println(value);
 }
 
-byte getBleTimer() {
-  byte result = EEPROM.read(EEPROM_BLE_TIMER);
+void onVolumeChanged(const char *value) {
+  changeVolume(_volume);
+}
 
-  if (result == 255) {
-    result = 0;
+void onMusicChanged(const char *value) {
+  if (_state != STOPPED) {
+    stopAnimationMode();
+    startAnimationMode();
   }
-
-  return result;
 }
 
-void saveColor() {
-  EEPROM.update(EEPROM_COLOR, _color[0]);
-  EEPROM.update(EEPROM_COLOR + 1, _color[1]);
-  EEPROM.update(EEPROM_COLOR + 2, _color[2]);
+void onMotorSpeedChanged(const char *value) {
+  if (_state == ANIMATION) {
+    startMotor(_motorSpeed);
+  }
 }
 
-void saveVolume(byte value) {
-  EEPROM.update(EEPROM_VOLUME, value);
-  _volume = value;
+void onNameCommand(const char *name) {
+  Serial.print(F("Name: "));
+  Serial.println(name);
+  ble.print("+++");
+  delay(500);
+  ble.print(F("AT+NAME=[omc] "));
+  ble.print(name);
+  delay(500);
+  ble.print("AT+EXIT");
 }
 
-void saveMusic(byte value) {
-  EEPROM.update(EEPROM_MUSIC, value);
-  _music = value;
+void startBleStopTimer() {
+  if (_bleTimer > 0) {
+    _bleStopTimer = millis();
+    _bleStopTimerRunning = true;
+    Serial.println(F("Ble timer started"));
+  }
 }
 
-void saveTimer(byte value) {
-  EEPROM.update(EEPROM_TIMER, value);
-  _timer = value;
+void stopBleStopTimer() {
+  _bleStopTimerRunning = false;
+  Serial.println(F("Ble timer stopped"));
 }
 
-void saveMotorSpeed(int value) {
- byte *b = (byte *)&value;
-
- for (byte i = 0; i < sizeof(value); i++) {
-  EEPROM.update(EEPROM_MOTOR_SPEED + i, b[i]);
- }
-
- _motorSpeed = value;
+void turnOnAdvertising() {
+  ble.print("AT+ADV=1");
+  delay(50);
+  ble.print("AT+RESET");
+  Serial.println(F("Advertising on"));
 }
 
-void saveBleTimer(byte value) {
-  EEPROM.update(EEPROM_BLE_TIMER, value);
-  _bleTimer = value;
+void turnOffAdvertising() {
+  ble.print("+++");
+  delay(50);
+  ble.print("AT+DISCON=0");
+  delay(50);
+  ble.print("AT+DISCON=1");
+  delay(50);
+  ble.print("AT+ADV=0");
+  delay(50);
+  ble.print("AT+EXIT");
+  delay(50);
+  Serial.println(F("Advertising off"));
 }
 
-String parseCommand(String data, char separator, int index)
-{
-  int found = 0;
-  int strIndex[] = {0, -1};
-  int maxIndex = data.length() - 1;
-
-  for (int i = 0; i <= maxIndex && found <= index; i++) {
-    if (data.charAt(i) == separator || i == maxIndex || data.charAt(i) == '\n' || data.charAt(i) == '\r') {
-      found++;
-      strIndex[0] = strIndex[1] + 1;
-      strIndex[1] = (i == maxIndex) ? i + 1 : i;
-    }
+void displayColor() {
+  for (int i = 0; i < NUM_LEDS; i++) {
+    leds[i] = CRGB (_color[0], _color[1], _color[2]);
   }
 
-  return found > index ? data.substring(strIndex[0], strIndex[1]) : "";
+  showLeds();
 }
@@ -9,12 +9,29 @@
 #define MY_TRANSPORT_MAX_TX_FAILURES (3u)
 
 #include <MySensors.h>
+#include <EdgeLatch.h>
+#include <EventCoalescer.h>
 
 #define PIR_ID 0
+#define LATENCY_ID 1
+#define BURST_ID 2
 #define PIR_PIN 3
 #define LED_PIN 4
+#define HOUSEKEEPING_INTERVAL 43200000UL // 12H
+#define BURST_WINDOW 30000UL
 
 MyMessage msg(PIR_ID, V_TRIPPED);
+MyMessage msgLatency(LATENCY_ID, V_CUSTOM);
+MyMessage msgBurst(BURST_ID, V_CUSTOM);
+EdgeLatch pirLatch(PIR_PIN);
+EventCoalescer pirBurst(BURST_WINDOW);
+uint8_t reportedValue = 2; // last state sent on PIR_ID
+unsigned long sleptTime = 0;         // millis() does not run while sleeping
+unsigned long housekeepingTime = 0;  // node time of the last latency report
+
+ISR(PCINT2_vect) {
+  pirLatch.handleInterrupt();
+}
 
 #ifdef REPORT_BATTERY_LEVEL
 #include <Vcc.h>
@@ -46,6 +63,7 @@ void setup()
   }
 
   pinMode(LED_PIN, INPUT);
+  pirLatch.begin();
 }
 
 void presentation()
@@ -54,12 +72,76 @@ void presentation()
   sendSketchInfo("Motion Sensor", "1.0");
   wait(500);
   present(PIR_ID, S_MOTION);
+  present(LATENCY_ID, S_CUSTOM, "Edge to ACK latency");
+  present(BURST_ID, S_CUSTOM, "Event burst");
 }
 
 void loop()
 {
-  bool tripped = digitalRead(PIR_PIN) == HIGH;
+  // Event first: the state latched by the interrupt is sent before anything else
+  if (pirLatch.available()) {
+    bool tripped = pirLatch.read() == HIGH;
+    updateLed(tripped);
+
+    // only the first edge of a burst is sent, the re-triggers go in its summary
+    if (pirBurst.event(tripped)) {
+      sendMotion(tripped);
+      reportedValue = tripped;
+    }
+  }
+
+  if (pirBurst.summaryDue()) {
+    // the burst can end in another state than its first edge
+    if (pirBurst.getState() != reportedValue) {
+      reportedValue = pirBurst.getState();
+      sendMotion(reportedValue);
+    }
+
+    String burstMsg = "burst-" + String(pirBurst.getState()) + "-" + String(pirBurst.getCount()) + "-" + String(pirBurst.getDuration());
+    send(msgBurst.set(burstMsg.c_str()));
+    pirBurst.summarySent();
+  }
+
+  // Housekeeping once the motion has been sent
+  reportBatteryLevel();
+  housekeeping();
+
+  if (!pirLatch.available()) {
+    // a summary due by now must not turn into a sleep without timeout
+    unsigned long sleepTime = pirLatch.sleepTime(max(min(pirBurst.timeToSummary(), timeToHousekeeping()), 1UL));
+    sleep(digitalPinToInterrupt(PIR_PIN), CHANGE, sleepTime);
+
+    unsigned long slept = sleepTime - getSleepRemaining();
+    pirBurst.slept(slept);
+    sleptTime += slept;
+  }
+}
+
+// millis() plus the time slept, as EventCoalescer counts it
+unsigned long nodeTime()
+{
+  return millis() + sleptTime;
+}
 
+// Latency is reported every HOUSEKEEPING_INTERVAL of node time, however
+// often the edges cut the sleeps short
+void housekeeping()
+{
+  if (nodeTime() - housekeepingTime >= HOUSEKEEPING_INTERVAL) {
+    reportLatency();
+    housekeepingTime = nodeTime();
+  }
+}
+
+unsigned long timeToHousekeeping()
+{
+  unsigned long elapsed = nodeTime() - housekeepingTime;
+
+  return elapsed >= HOUSEKEEPING_INTERVAL ? 0 : HOUSEKEEPING_INTERVAL - elapsed;
+}
+
+void updateLed(bool tripped)
+{
 #ifdef LED_ENABLE
   pinMode(LED_PIN, OUTPUT);
   if (tripped) {
@@ -69,17 +151,24 @@ void loop()
     pinMode(LED_PIN, INPUT);
   }
 #endif
+}
 
+void sendMotion(bool tripped)
+{
   for (char i = 1; i < 6; i++) {
     bool success = send(msg.set(tripped?"1":"0"));
 
     if (success) {
+      pirLatch.acknowledged();
       break;
     } else {
       sleep(10 * i);
     }
   }
+}
 
+void reportBatteryLevel()
+{
 #ifdef REPORT_BATTERY_LEVEL
   const uint8_t batteryPcnt = static_cast<uint8_t>(0.5 + vcc.Read_Perc(VccMin, VccMax));
 
@@ -98,6 +187,13 @@ void loop()
     oldBatteryPcnt = batteryPcnt;
   }
 #endif
+}
 
-  sleep(digitalPinToInterrupt(PIR_PIN), CHANGE, 0);
+void reportLatency()
+{
+  if (pirLatch.getCount() > 0) {
+    String latencyMsg = "latency-" + String(pirLatch.getAverageLatency()) + "-" + String(pirLatch.getMaxLatency());
+    send(msgLatency.set(latencyMsg.c_str()));
+    pirLatch.resetLatency();
+  }
 }
@@ -6,15 +6,24 @@
 #define MY_RF24_PA_LEVEL (RF24_PA_MAX)
 
 #include <MySensors.h>
+#include <SendQueue.h>
+#include <EventCoalescer.h>
 
 #define PIR_PIN 3
 #define LED_PIN A2
 #define CAM_POWER_PIN A1
 #define CAM_STATUS_PIN A0
 
+#define BURST_ID 1
+#define BURST_WINDOW 10000UL
+
 MyMessage msg(0, V_TRIPPED);
+MyMessage msgBurst(BURST_ID, V_CUSTOM);
 unsigned long startCamTime = 0;
 bool oldTripped = false;
+SendQueue sendQueue(50);
+EventCoalescer pirBurst(BURST_WINDOW);
+uint8_t reportedValue = 2; // last state pushed on child 0
 
 void before()
 {
@@ -44,6 +53,12 @@ void presentation()
 {
   sendSketchInfo("PIR with camera", "1.0");
   present(0, S_MOTION);
+  present(BURST_ID, S_CUSTOM, "Event burst");
+}
+
+void receive(const MyMessage &message)
+{
+  sendQueue.receive(message);
 }
 
 void loop()
@@ -60,13 +75,30 @@ void loop()
   }
 #endif
 
-  if (tripped != oldTripped) {
-    sendWithRetry(msg.set(tripped?"1":"0"), 10);
+  // only the first edge of a burst is sent, the re-triggers go in its summary
+  if (tripped != oldTripped && pirBurst.event(tripped)) {
+    sendQueue.push(msg.set(tripped?"1":"0"));
+    reportedValue = tripped;
   }
 
+  if (pirBurst.summaryDue()) {
+    // the burst can end in another state than its first edge
+    if (pirBurst.getState() != reportedValue) {
+      reportedValue = pirBurst.getState();
+      sendQueue.push(msg.set(reportedValue?"1":"0"));
+    }
+
+    String burstMsg = "burst-" + String(pirBurst.getState()) + "-" + String(pirBurst.getCount()) + "-" + String(pirBurst.getDuration());
+    sendQueue.push(msgBurst.set(burstMsg.c_str()));
+    pirBurst.summarySent();
+  }
+
+  sendQueue.process();
+
   oldTripped = tripped;
 
-  if (!tripped && millis() - startCamTime > 11000UL && digitalRead(PIR_PIN) == LOW) {
+  if (!tripped && millis() - startCamTime > 11000UL && digitalRead(PIR_PIN) == LOW && sendQueue.isEmpty() &&
+      pirBurst.timeToSummary() == EVENT_NO_SUMMARY) {
     stopCam();
     sleep(digitalPinToInterrupt(PIR_PIN), HIGH, 0);
     startCam();
@@ -83,22 +115,3 @@ void stopCam() {
   digitalWrite(CAM_POWER_PIN, LOW);
   pinMode(CAM_POWER_PIN, INPUT);
 }
-
-boolean sendWithRetry(MyMessage &message, const byte retryNumber) {
-  byte counter = retryNumber;
-  bool success = false;
-
-  do {
-    success = send(message, true);
-
-    if (success) {
-      success = wait(500, message.getCommand(), message.type);
-    }
-
-    if (!success && counter != 0 && (retryNumber - counter) > 0) {
-      delay(50 * (retryNumber - counter));
-    }
-  } while (!success && counter--);
-
-  return success;
-}
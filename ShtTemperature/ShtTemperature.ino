@@ -1,6 +1,10 @@
 // Enable debug prints to serial monitor
 //#define MY_DEBUG
 
+// Enable TELEMETRY_FRAME to send all values and the battery in one packed message, expanded by the gateway
+// (update the gateway first, the controller only sees the expanded values)
+//#define TELEMETRY_FRAME
+
 #define MY_RADIO_RF24
 #define MY_RF24_PA_LEVEL (RF24_PA_MAX)
 
@@ -10,6 +14,7 @@
 #include <Wire.h>
 #include "DFRobot_SHT20.h"
 #include <BatteryLevel.h>
+#include <TelemetryFrame.h>
 
 #define CHILD_ID_HUM  0
 #define CHILD_ID_TEMP 1
@@ -20,6 +25,11 @@ DFRobot_SHT20 sht20;
 BatteryLevel battery(INTERNAL_MEASUREMENT, EEPROM_VOLTAGE_CORRECTION, CR2032_LITHIUM);
 int batteryPercent = 101;
 
+#ifdef TELEMETRY_FRAME
+TelemetryFrame frame;
+MyMessage msgFrame(TELEMETRY_CHILD_ID, V_CUSTOM);
+#endif
+
 void before()
 {
   sht20.initSHT20();
@@ -39,22 +49,40 @@ void presentation()
   sendSketchInfo("SHT Temperature", "1.0");
   present(CHILD_ID_HUM, S_HUM, "Humidity");
   present(CHILD_ID_TEMP, S_TEMP, "Temperature");
+#ifdef TELEMETRY_FRAME
+  present(TELEMETRY_CHILD_ID, S_MULTIMETER, "Battery");
+#endif
 }
 
 void loop()
 {
   const float temperature = sht20.readTemperature();
   const float humidity = sht20.readHumidity();
-  send(msgTemp.set(temperature, 1));
-  send(msgHum.set(humidity, 0));
 
   battery.compute();
   //String voltageMsg = "voltage-" + String(battery.getVoltage()) + "-" + String(battery.getPercent());
   //Serial.println(voltageMsg);
+
+#ifdef TELEMETRY_FRAME
+  frame.clear();
+  frame.add(CHILD_ID_TEMP, V_TEMP, lround(temperature * 10), 1);
+  frame.add(CHILD_ID_HUM, V_HUM, lround(humidity), 0);
+
+  if (battery.getPercent() < batteryPercent) {
+    frame.setBattery(battery.getPercent(), battery.getMillivolts());
+    batteryPercent = battery.getPercent();
+  }
+
+  send(msgFrame.set(frame.data(), frame.length()));
+#else
+  send(msgTemp.set(temperature, 1));
+  send(msgHum.set(humidity, 0));
+
   if (battery.getPercent() < batteryPercent) {
     sendBatteryLevel(battery.getPercent());
     batteryPercent = battery.getPercent();
   }
+#endif
 
   sleep(300000);
 }
@@ -4,6 +4,10 @@
 // Enable REPORT_BATTERY_LEVEL to measure battery level and send changes to gateway
 #define REPORT_BATTERY_LEVEL
 
+// Enable TELEMETRY_FRAME to send all values and the battery in one packed message, expanded by the gateway
+// (update the gateway first, the controller only sees the expanded values)
+//#define TELEMETRY_FRAME
+
 // Enable and select radio type attached 
 #define MY_RADIO_RF24
 
@@ -19,10 +23,25 @@ static bool metric = true;
 
 // Sleep time between sensor updates (in milliseconds)
 static const uint64_t UPDATE_INTERVAL = 600000; // 10 minutes
+#define UPDATE_INTERVAL_MINUTES 10
+
+#define EEPROM_TEMP_REPORT EEPROM_LOCAL_CONFIG_ADDRESS + 0
+#define EEPROM_HUM_REPORT EEPROM_TEMP_REPORT + REPORT_SETTINGS_EEPROM_SIZE
 
 #include <SI7021.h>
+#include <TemperatureFormat.h>
+#include <ChangeReporter.h>
+#include <TelemetryFrame.h>
 static SI7021 sensor;
 
+// dead-band, relative band, hysteresis, rate per hour, heartbeat in minutes
+static ChangeReporter tempReporter({20, REPORT_OFF, REPORT_OFF, 300, 120}); // hundredths of degree
+static ChangeReporter humReporter({2, REPORT_OFF, REPORT_OFF, 30, 120});    // percent
+
+#ifdef TELEMETRY_FRAME
+static TelemetryFrame frame;
+#endif
+
 #ifdef REPORT_BATTERY_LEVEL
 #include <Vcc.h>
 static uint8_t oldBatteryPcnt = 200;  // Initialize to 200 to assure first time value will be sent.
@@ -40,6 +59,9 @@ void presentation()
   // Present sensors as children to gateway
   present(CHILD_ID_HUM, S_HUM,   "Humidity");
   present(CHILD_ID_TEMP, S_TEMP, "Temperature");
+#ifdef TELEMETRY_FRAME
+  present(TELEMETRY_CHILD_ID, S_MULTIMETER, "Battery");
+#endif
 
   metric = getControllerConfig().isMetric;
 }
@@ -56,28 +78,66 @@ void setup()
     Serial.println(F("Sensor not detected!"));
     delay(5000);
   }
+
+  tempReporter.begin(EEPROM_TEMP_REPORT);
+  humReporter.begin(EEPROM_HUM_REPORT);
+}
+
+void receive(const MyMessage &message) {
+  if (message.type == V_CUSTOM) {
+    if (message.sensor == CHILD_ID_TEMP) {
+      tempReporter.configure(message.getString());
+    } else if (message.sensor == CHILD_ID_HUM) {
+      humReporter.configure(message.getString());
+    }
+  }
 }
 
 
 void loop()      
 {  
-  // Read temperature & humidity from sensor.
-  const float temperature = float( metric ? sensor.getCelsiusHundredths() : sensor.getFahrenheitHundredths() ) / 100.0;
-  const float humidity    = float( sensor.getHumidityBasisPoints() ) / 100.0;
+  // One RH conversion gives both values, sleep while the sensor works
+  si7021_env env;
+  bool tempChanged = false;
+  bool humChanged = false;
+  sensor.startConversion();
+  sleep(SI7021_CONVERSION_MS);
+
+  if (sensor.readConversion(&env)) {
+    const int temperature = metric ? env.celsiusHundredths : env.fahrenheitHundredths;
 
 #ifdef MY_DEBUG
-  Serial.print(F("Temp "));
-  Serial.print(temperature);
-  Serial.print(metric ? 'C' : 'F');
-  Serial.print(F("\tHum "));
-  Serial.println(humidity);
+    Serial.print(F("Temp "));
+    Serial.print(temperature);
+    Serial.print(metric ? 'C' : 'F');
+    Serial.print(F("\tHum "));
+    Serial.println(env.humidityBasisPoints);
 #endif
 
-  static MyMessage msgHum( CHILD_ID_HUM,  V_HUM );
-  static MyMessage msgTemp(CHILD_ID_TEMP, V_TEMP);
-
-  send(msgTemp.set(temperature, 1));
-  send(msgHum.set(humidity, 0));
+    tempChanged = tempReporter.update(temperature, UPDATE_INTERVAL_MINUTES);
+    humChanged = humReporter.update(env.humidityPercent, UPDATE_INTERVAL_MINUTES);
+
+#ifdef TELEMETRY_FRAME
+    if (tempChanged) {
+      frame.add(CHILD_ID_TEMP, V_TEMP, temperature, 2);
+    }
+    if (humChanged) {
+      frame.add(CHILD_ID_HUM, V_HUM, env.humidityPercent, 0);
+    }
+#else
+    char buffer[TEMPERATURE_FORMAT_SIZE];
+    static MyMessage msgHum( CHILD_ID_HUM,  V_HUM );
+    static MyMessage msgTemp(CHILD_ID_TEMP, V_TEMP);
+
+    if (tempChanged && send(msgTemp.set(formatTemperature(temperature, buffer)))) {
+      tempReporter.markReported();
+    }
+
+    if (humChanged && send(msgHum.set(env.humidityPercent))) {
+      humReporter.markReported();
+    }
+#endif
+  }
 
 #ifdef REPORT_BATTERY_LEVEL
   const uint8_t batteryPcnt = static_cast<uint8_t>(0.5 + vcc.Read_Perc(VccMin, VccMax));
@@ -92,11 +152,34 @@ void loop()
   // Battery readout should only go down. So report only when new value is smaller than previous one.
   if ( batteryPcnt < oldBatteryPcnt )
   {
+#ifdef TELEMETRY_FRAME
+      frame.setBattery(batteryPcnt, vcc.Read_Volts() * 1000);
+#else
       sendBatteryLevel(batteryPcnt);
+#endif
       oldBatteryPcnt = batteryPcnt;
   }
 #endif
 
+#ifdef TELEMETRY_FRAME
+  // One radio wake for every changed value
+  static MyMessage msgFrame(TELEMETRY_CHILD_ID, V_CUSTOM);
+
+  if (!frame.isEmpty() && send(msgFrame.set(frame.data(), frame.length()))) {
+    if (tempChanged) {
+      tempReporter.markReported();
+    }
+    if (humChanged) {
+      humReporter.markReported();
+    }
+  }
+  frame.clear();
+#endif
+
+  // listen a moment so a report configuration sent by the controller gets in
+  RF24_startListening();
+  wait(15);
+
   // Sleep until next update to save energy
   sleep(UPDATE_INTERVAL); 
 }
@@ -34,6 +34,7 @@
 //#include <Keypad.h>
 #include <RGBLed.h>  // https://github.com/wilmouths/RGBLed
 #include <Parser.h>
+#include <SirenPattern.h>
 
 // Keypad
 /*char* _password = "0000";
@@ -54,10 +55,8 @@
 */
 
 // Siren
-unsigned long _sirenTime = 0;
-int _sirenState = 0;
-byte _bipNumber = 0;
-byte _sirenLevel = 100;
+SirenPattern siren(SIREN);
+bool _sirenLedOn = false;
 
 // Buzzer
 int _buzzerDuration = 0;
@@ -76,12 +75,16 @@ MyMessage msgRelay(1, V_CUSTOM);
 MyMessage msgToRelay;
 unsigned long relayTimer = 0;
 
+ISR(TIMER1_COMPA_vect) {
+  siren.handleInterrupt();
+}
+
 void before()
 {
-  pinMode(SIREN, OUTPUT);
   pinMode(BUZZER, OUTPUT);
   pinMode(POWER_PROBE, INPUT);
 
+  siren.begin();
   stopSiren();
   stopBuzzer();
   led.setColor(RGBLed::RED);
@@ -117,6 +120,18 @@ void receive(const MyMessage &myMsg)
     } else if (parser.isEqual(0, "start") && parser.get(1) != NULL && parser.get(2) != NULL) {
       startSiren(parser.getInt(1), parser.getInt(2));
       send(msg.set(F("siren started")));
+    } else if (parser.isEqual(0, "pattern") && parser.get(1) != NULL) {
+      if (siren.upload(parser.get(1))) {
+        send(msg.set(F("pattern saved")));
+      } else {
+        send(msg.set(F("pattern invalid")));
+      }
+    } else if (parser.isEqual(0, "play") && parser.get(1) != NULL) {
+      if (siren.playUploaded(parser.getInt(1), 1, 180000)) {
+        send(msg.set(F("pattern started")));
+      } else {
+        send(msg.set(F("no pattern")));
+      }
       /*    } else if (parser.isEqual(0, "password") && parser.get(1) != NULL) {
             if (strlen(parser.get(1)) != 4) {
               send(msg.set(F("password shall be on 4 c")));
@@ -133,6 +148,8 @@ void receive(const MyMessage &myMsg)
       send(msg.set(F("cmd3: start [bip] [level]")));
       send(msg.set(F("cmd4: password [pswd]")));
       send(msg.set(F("cmd5: buzzer [duration]")));
+      send(msg.set(F("cmd6: pattern [l,d,r;...]")));
+      send(msg.set(F("cmd7: play [level] once")));
     } else {
       send(msg.set(F("command invalid")));
     }
@@ -190,37 +207,32 @@ void sendNrfStatus() {
 }
 
 void startSiren(char bipBumber, char level) {
-  _bipNumber = bipBumber;
-  _sirenLevel = level;
-  _sirenTime = 0;
-  _sirenState = 1;
+  siren.play(SIREN_ALARM, level, bipBumber, 180000);
   DEBUG_PRINT(F("Siren started!"));
 }
 
 void stopSiren() {
-  _sirenState = 0;
-  stopSirenSound();
+  siren.stop();
   DEBUG_PRINT(F("Siren stopped!"));
 }
 
 bool isSirenOn() {
-  return _sirenState != 0;
+  return siren.isPlaying();
 }
 
 inline void manageSiren() {
-  if (_sirenState != 0) {
-    if ((_sirenState % 2 == 1 && _sirenState < _bipNumber * 2 + 2) && millis() - _sirenTime >= 1000) {
-      startSirenSound(_sirenLevel);
-      _sirenTime = millis();
-      _sirenState++;
-    } else if ((_sirenState % 2 == 0 && _sirenState < _bipNumber * 2 + 2) && millis() - _sirenTime >= 100) {
-      stopSirenSound();
-      _sirenTime = millis();
-      _sirenState++;
-    } else if ((_sirenState == _bipNumber * 2 + 2) && millis() - _sirenTime >= 180000) {
-      DEBUG_PRINT(F("Siren stopped after 3 min!"));
-      stopSiren();
-      send(msg.set(F("siren stopped")));
+  if (siren.hasFinished()) {
+    DEBUG_PRINT(F("Siren stopped after 3 min!"));
+    send(msg.set(F("siren stopped")));
+  }
+
+  if (siren.isPlaying() != _sirenLedOn) {
+    _sirenLedOn = siren.isPlaying();
+
+    if (_sirenLedOn) {
+      led.setColor(RGBLed::GREEN);
+    } else {
+      showPowerLed();
     }
   }
 }
@@ -261,14 +273,7 @@ inline void manageSiren() {
   }
 */
 
-void startSirenSound(char level) {
-  analogWrite(SIREN, map(level, 0, 100, 0, 255));
-  led.setColor(RGBLed::GREEN);
-}
-
-void stopSirenSound() {
-  analogWrite(SIREN, 0);
-
+void showPowerLed() {
   if (_isOnBattery) {
     led.setColor(RGBLed::RED);
   } else {
@@ -33,6 +33,7 @@
 #include <Bounce2.h>
 #include <MySensors.h>
 #include <Parser.h>
+#include <SirenPattern.h>
 #include <Timer.h>
 
 // Child ID
@@ -58,13 +59,14 @@ MyMessage msgSoundLevel(CHILD_ID_CONFIG_SOUND_LEVEL, V_TEXT);
 MyMessage msgBipNumber(CHILD_ID_CONFIG_BIP_NUMBER, V_TEXT);
 MyMessage msgBuzzer(CHILD_ID_BUZZER, V_STATUS);
 MyMessage msgRedLed(CHILD_ID_RED_LED, V_STATUS);
-unsigned long _sirenTime = 0;
-int _sirenState = 0;
-byte _bipNumber = 0;
-byte _sirenLevel = 100;
+SirenPattern siren(SIREN_PIN);
 byte _soundLevelConfig = 100;
 byte _bipNumberConfig = 0;
 
+ISR(TIMER1_COMPA_vect) {
+  siren.handleInterrupt();
+}
+
 // DHT
 #if defined(DHT_SENSOR)
 #include <DHT.h>
@@ -72,6 +74,11 @@ MyMessage msgHum(CHILD_ID_HUM, V_HUM);
 MyMessage msgTemp(CHILD_ID_TEMP, V_TEMP);
 DHT dht;
 unsigned long lastSendTemperatureTime = 0;
+
+// DHT_PIN is on port D
+ISR(PCINT2_vect) {
+  dht.handleInterrupt();
+}
 #endif
 
 // PIR
@@ -91,7 +98,7 @@ MyMessage msgRf(CHILD_ID_RF, V_CUSTOM);
 
 // Buttons
 const byte buttons[] = {BUTTON1_PIN, BUTTON2_PIN};
-Bounce* keys[sizeof(buttons)];
+BounceBank keys;
 int button1OldValue = -1;
 byte _password[4] = {1, 2, 2, 1};
 int _passwordPosition = 0;
@@ -109,13 +116,13 @@ unsigned long _heartbeatTime = 0;
 unsigned long _buzzerTimer = 0;
 
 void before() {
-  pinMode(SIREN_PIN, OUTPUT);
   pinMode(POWER_PROBE_PIN, INPUT);
   pinMode(PIR_PIN, INPUT);
   pinMode(GREEN_LED_PIN, OUTPUT);
   pinMode(RED_LED_PIN, OUTPUT);
   pinMode(BUZZER_PIN, OUTPUT);
 
+  siren.begin();
   stopSiren();
   setGreenLedOn(true);
   setRedLedOn(true);
@@ -145,10 +152,9 @@ void setup() {
 #endif
 
   for (byte i = 0; i < sizeof(buttons); i++) {
-    keys[i] = new Bounce();
-    keys[i]->attach(buttons[i], INPUT_PULLUP);
-    keys[i]->interval(25);
+    keys.attach(buttons[i], INPUT_PULLUP);
   }
+  keys.interval(25);
 
   for (byte i = 0; i < 10; i++) {
     if (i % 2 == 0) {
@@ -202,6 +208,21 @@ void receive(const MyMessage& myMsg) {
     } else if (parser.isEqual(0, "start") && parser.get(1) != NULL && parser.get(2) != NULL) {
       startSiren(parser.getInt(1), parser.getInt(2));
       send(msgSiren.set(F("siren started")));
+    } else if (parser.isEqual(0, "pattern") && parser.get(1) != NULL) {
+      if (siren.upload(parser.get(1))) {
+        send(msgSiren.set(F("pattern saved")));
+      } else {
+        send(msgSiren.set(F("pattern invalid")));
+      }
+    } else if (parser.isEqual(0, "play")) {
+      byte level = parser.get(1) != NULL ? parser.getInt(1) : _soundLevelConfig;
+
+      if (siren.playUploaded(level, _bipNumberConfig, 180000)) {
+        send(msgSiren.set(F("pattern started")));
+        send(msgSirenStartStop.set(true));
+      } else {
+        send(msgSiren.set(F("no pattern")));
+      }
     } else {
       send(msgSiren.set(F("command invalid")));
     }
@@ -281,9 +302,9 @@ inline void manageRfReceptor() {
 inline void manageButtons() {
   // get pressed button number
   byte button = 0;
+  keys.update();
   for (byte i = 0; i < sizeof(buttons); i++) {
-    keys[i]->update();
-    if (keys[i]->fell()) {
+    if (keys.fell() & BounceBank::pinMask(buttons[i])) {
       button += i + 1;
       _keyboardEnableTime = millis();
     }
@@ -323,17 +344,19 @@ inline void manageDhtSensor() {
 #if defined(DHT_SENSOR)
   if ((millis() - lastSendTemperatureTime) >= 600000) {
     lastSendTemperatureTime = millis();
-    dht.readSensor(true);  // Force reading sensor, so it works also after sleep
+    dht.startReading();
+  }
 
-    float temperature = dht.getTemperature();
-    if (!isnan(temperature)) {
-      send(msgTemp.set(temperature, 1));
+  // Frame is captured by interrupt, loop is never blocked
+  if (dht.processReading()) {
+    if (dht.getStatus() != DHT::ERROR_NONE) {
+      DEBUG_PRINT(F("DHT error:"));
+      DEBUG_PRINT(dht.getStatusString());
+      return;
     }
 
-    float humidity = dht.getHumidity();
-    if (!isnan(humidity)) {
-      send(msgHum.set(humidity, 1));
-    }
+    send(msgTemp.set(dht.getTemperature(), 1));
+    send(msgHum.set(dht.getHumidity(), 1));
   }
 #endif
 }
@@ -374,50 +397,27 @@ inline void managePowerProbe() {
 }
 
 void startSiren(byte bipBumber, byte level) {
-  _bipNumber = bipBumber;
-  _sirenLevel = level;
-  _sirenTime = 0;
-  _sirenState = 1;
+  siren.play(SIREN_ALARM, level, bipBumber, 180000);
   DEBUG_PRINT(F("Siren started!"));
 }
 
 void stopSiren() {
-  _sirenState = 0;
-  stopSirenSound();
+  siren.stop();
   DEBUG_PRINT(F("Siren stopped!"));
 }
 
 bool isSirenOn() {
-  return _sirenState != 0;
+  return siren.isPlaying();
 }
 
 inline void manageSiren() {
-  if (_sirenState != 0) {
-    if ((_sirenState % 2 == 1 && _sirenState < _bipNumber * 2 + 2) && millis() - _sirenTime >= 1000) {
-      startSirenSound(_sirenLevel);
-      _sirenTime = millis();
-      _sirenState++;
-    } else if ((_sirenState % 2 == 0 && _sirenState < _bipNumber * 2 + 2) && millis() - _sirenTime >= 100) {
-      stopSirenSound();
-      _sirenTime = millis();
-      _sirenState++;
-    } else if ((_sirenState == _bipNumber * 2 + 2) && millis() - _sirenTime >= 180000) {
-      DEBUG_PRINT(F("Siren stopped after 180s!"));
-      stopSiren();
-      send(msgSiren.set(F("siren stopped")));
-      send(msgSirenStartStop.set(false));
-    }
+  if (siren.hasFinished()) {
+    DEBUG_PRINT(F("Siren stopped after 180s!"));
+    send(msgSiren.set(F("siren stopped")));
+    send(msgSirenStartStop.set(false));
   }
 }
 
-void startSirenSound(char level) {
-  analogWrite(SIREN_PIN, map(level, 0, 100, 0, 255));
-}
-
-void stopSirenSound() {
-  analogWrite(SIREN_PIN, 0);
-}
-
 void setGreenLedOn(bool on) {
   if (on) {
     digitalWrite(GREEN_LED_PIN, HIGH);
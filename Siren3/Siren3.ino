@@ -30,6 +30,8 @@
 // Includes
 #include <MySensors.h>
 #include <Parser.h>
+#include <RelayHeader.h>
+#include <SirenPattern.h>
 
 #include "BatteryLevel.h"
 
@@ -44,34 +46,90 @@
 
 // Siren
 MyMessage msgSirenLegacy(CHILD_ID_SIREN_LEGACY, V_CUSTOM);
-unsigned long _sirenTime = 0;
-int _sirenState = 0;
-byte _bipNumber = 0;
-byte _sirenLevel = 100;
+SirenPattern siren(SIREN_PIN);
 unsigned long _sirenDurationConfig = 0;
 byte _soundLevelConfig = 100;
 byte _bipNumberConfig = 0;
 
+// Power
+#define POWER_LOW_VOLTAGE 3.7          // on battery below: no relay, minimum PA level
+#define POWER_LOW_RECOVER_VOLTAGE 3.8
+#define POWER_SLEEP_VOLTAGE 3.5        // on battery below: radio off and MCU asleep
+#define POWER_WAKEUP_VOLTAGE 3.6
+#define POWER_SLEEP_STEP 8000UL        // power supply return is checked between steps
+#define POWER_SLEEP_BATTERY_CHECK 60000UL
+
+enum PowerTier { POWER_MAINS, POWER_BATTERY, POWER_BATTERY_LOW };
+
+struct PowerProfile {
+  unsigned long heartbeatInterval;
+  unsigned long batteryCheckInterval;
+  unsigned long onBatteryInterval;
+  bool relay;
+  byte paLevel;
+};
+
+const PowerProfile _powerProfiles[] = {
+  {3600000UL, 10000UL, 3600000UL, true, MY_RF24_PA_LEVEL},
+  {10800000UL, 60000UL, 10800000UL, true, MY_RF24_PA_LEVEL},
+  {21600000UL, 300000UL, 21600000UL, false, RF24_PA_MIN}
+};
+
+byte _powerTier = POWER_MAINS;
+volatile bool _powerProbeChanged = true;
+bool _isOnBattery = false;
+
 // Others
 Parser parser = Parser(' ');
 unsigned long _heartbeatTime = 0;
 BatteryLevel battery(BATTERY_LEVEL_PIN, EEPROM_VOLTAGE_CORRECTION, Lithium);
-bool _isOnBattery = false;
 
 // Message relay
+#define RELAY_QUEUE_SIZE 4
+#define RELAY_TIMEOUT 2500UL
+#define RELAY_RETRY_INTERVAL 5UL
+#define RELAY_DUPLICATE_WINDOW 5000UL  // same request from same sender within this delay is a duplicate
+
+// MySensors messages carry no sequence number: a request is known by its sender
+// and the checksum of its text. The controller repeats an unanswered request
+// as is, but must change the payload (a counter, a timestamp) to relay the same
+// command again within RELAY_DUPLICATE_WINDOW, else it only gets the cached
+// success back.
+
+enum RelayState { RELAY_FREE, RELAY_PENDING, RELAY_SUCCESS };
+
+struct RelayEntry {
+  MyMessage message;
+  byte requester;
+  uint16_t checksum;
+  byte state;
+  unsigned long startTime;
+  unsigned long tryTime;
+};
+
 MyMessage msgRelayLegacy(CHILD_ID_MSG_RELAY_LEGACY, V_CUSTOM);
 MyMessage msgRelay(CHILD_ID_MSG_RELAY, V_TEXT);
-MyMessage msgToRelay;
-unsigned long relayTimer = 0;
+RelayEntry _relayQueue[RELAY_QUEUE_SIZE];
 
 MyMessage msgSirenStartStop(CHILD_ID_SIREN_START_STOP, V_STATUS);
 MyMessage msgSirenDuration(CHILD_ID_CONFIG_SIREN_DURATION, V_TEXT);
 MyMessage msgSoundLevel(CHILD_ID_CONFIG_SOUND_LEVEL, V_TEXT);
 MyMessage msgBipNumber(CHILD_ID_CONFIG_BIP_NUMBER, V_TEXT);
 
+ISR(TIMER1_COMPA_vect) {
+  siren.handleInterrupt();
+}
+
+// POWER_PROBE_PIN is on port C
+ISR(PCINT1_vect) {
+  _powerProbeChanged = true;
+}
+
 void before() {
-  pinMode(SIREN_PIN, OUTPUT);
+  siren.begin();
   pinMode(POWER_PROBE_PIN, INPUT);
+  *digitalPinToPCMSK(POWER_PROBE_PIN) |= _BV(digitalPinToPCMSKbit(POWER_PROBE_PIN));
+  *digitalPinToPCICR(POWER_PROBE_PIN) |= _BV(digitalPinToPCICRbit(POWER_PROBE_PIN));
 
   stopSiren();
 
@@ -133,16 +191,31 @@ void receive(const MyMessage &message) {
       send(msgSirenLegacy.set(F("siren stopped by user")));
       send(msgSirenStartStop.set(false));
     } else if (parser.isEqual(0, "test")) {
-      startSirenSound(100);
-      delay(2000);
-      stopSirenSound();
+      siren.play(SIREN_ALARM, 100, 0, 2000);
     } else if (parser.isEqual(0, "start") && parser.get(1) != NULL && parser.get(2) != NULL) {
       startSiren(parser.getInt(1), parser.getInt(2));
       send(msgSirenLegacy.set(F("siren started")));
+    } else if (parser.isEqual(0, "pattern") && parser.get(1) != NULL) {
+      if (siren.upload(parser.get(1))) {
+        send(msgSirenLegacy.set(F("pattern saved")));
+      } else {
+        send(msgSirenLegacy.set(F("pattern invalid")));
+      }
+    } else if (parser.isEqual(0, "play")) {
+      byte level = parser.get(1) != NULL ? parser.getInt(1) : _soundLevelConfig;
+
+      if (siren.playUploaded(level, _bipNumberConfig, _sirenDurationConfig)) {
+        send(msgSirenLegacy.set(F("pattern started")));
+        send(msgSirenStartStop.set(true));
+      } else {
+        send(msgSirenLegacy.set(F("no pattern")));
+      }
     } else if (parser.isEqual(0, "help")) {
       send(msgSirenLegacy.set(F("cmd1: ping")));
       send(msgSirenLegacy.set(F("cmd2: stop")));
       send(msgSirenLegacy.set(F("cmd3: start [bip] [level]")));
+      send(msgSirenLegacy.set(F("cmd4: pattern [l,d,r;...]")));
+      send(msgSirenLegacy.set(F("cmd5: play [level]")));
     } else {
       send(msgSirenLegacy.set(F("command invalid")));
     }
@@ -194,6 +267,7 @@ void receive(const MyMessage &message) {
 
 void loop() {
   manageSiren();
+  manageRelays();
   managePowerProbe();
   manageBatteryLevel();
   manageHeartbeat();
@@ -202,72 +276,81 @@ void loop() {
 inline void managePowerProbe() {
   static unsigned long lastSend = 0;
 
-  if (digitalRead(POWER_PROBE_PIN) == HIGH) {
-    if (_isOnBattery) {
-      send(msgSirenLegacy.set(F("on power supply")));
-      _isOnBattery = false;
-    }
-  } else {
-    if (!_isOnBattery) {
-      send(msgSirenLegacy.set(F("on battery")));
-      lastSend = millis();
-      _isOnBattery = true;
-    } else {
-      if (millis() - lastSend >= 3600000UL) {
+  if (_powerProbeChanged) {
+    _powerProbeChanged = false;
+    bool onBattery = digitalRead(POWER_PROBE_PIN) == LOW;
+
+    if (onBattery != _isOnBattery) {
+      _isOnBattery = onBattery;
+
+      if (_isOnBattery) {
         send(msgSirenLegacy.set(F("on battery")));
-        lastSend = millis();
+      } else {
+        send(msgSirenLegacy.set(F("on power supply")));
       }
+
+      lastSend = millis();
+      battery.compute();
+      updatePowerTier();
     }
+  } else if (_isOnBattery && millis() - lastSend >= _powerProfiles[_powerTier].onBatteryInterval) {
+    send(msgSirenLegacy.set(F("on battery")));
+    lastSend = millis();
   }
 }
 
+// On battery the node first reports less often, then stops relaying and
+// lowers its PA level, and only sleeps below POWER_SLEEP_VOLTAGE
+void updatePowerTier() {
+  byte tier = POWER_MAINS;
+
+  if (_isOnBattery) {
+    if (battery.getVoltage() < POWER_LOW_VOLTAGE ||
+        (_powerTier == POWER_BATTERY_LOW && battery.getVoltage() < POWER_LOW_RECOVER_VOLTAGE)) {
+      tier = POWER_BATTERY_LOW;
+    } else {
+      tier = POWER_BATTERY;
+    }
+  }
+
+  if (tier == _powerTier) {
+    return;
+  }
+
+  if (tier == POWER_BATTERY_LOW) {
+    send(msgSirenLegacy.set(F("battery low: degraded mode")));
+  } else if (_powerTier == POWER_BATTERY_LOW) {
+    send(msgSirenLegacy.set(F("battery ok: normal mode")));
+  }
+
+  _powerTier = tier;
+  RF24_setTxPowerLevel(_powerProfiles[_powerTier].paLevel);
+}
+
 void startSiren(byte bipBumber, byte level) {
-  _bipNumber = bipBumber;
-  _sirenLevel = level;
-  _sirenTime = 0;
-  _sirenState = 1;
+  siren.play(SIREN_ALARM, level, bipBumber, _sirenDurationConfig);
   DEBUG_PRINT(F("Siren started!"));
 }
 
 void stopSiren() {
-  _sirenState = 0;
-  stopSirenSound();
+  siren.stop();
   DEBUG_PRINT(F("Siren stopped!"));
 }
 
 bool isSirenOn() {
-  return _sirenState != 0;
+  return siren.isPlaying();
 }
 
 inline void manageSiren() {
-  if (_sirenState != 0) {
-    if ((_sirenState % 2 == 1 && _sirenState < _bipNumber * 2 + 2) && millis() - _sirenTime >= 1000) {
-      startSirenSound(_sirenLevel);
-      _sirenTime = millis();
-      _sirenState++;
-    } else if ((_sirenState % 2 == 0 && _sirenState < _bipNumber * 2 + 2) && millis() - _sirenTime >= 100) {
-      stopSirenSound();
-      _sirenTime = millis();
-      _sirenState++;
-    } else if ((_sirenState == _bipNumber * 2 + 2) && millis() - _sirenTime >= _sirenDurationConfig) {
-      DEBUG_PRINT(F("Siren stopped by end of time!"));
-      stopSiren();
-      send(msgSirenLegacy.set(F("siren stopped")));
-      send(msgSirenStartStop.set(false));
-    }
+  if (siren.hasFinished()) {
+    DEBUG_PRINT(F("Siren stopped by end of time!"));
+    send(msgSirenLegacy.set(F("siren stopped")));
+    send(msgSirenStartStop.set(false));
   }
 }
 
-void startSirenSound(byte level) {
-  analogWrite(SIREN_PIN, map(level, 0, 100, 0, 255));
-}
-
-void stopSirenSound() {
-  analogWrite(SIREN_PIN, 0);
-}
-
 inline void manageHeartbeat() {
-  if (millis() - _heartbeatTime >= 3600000) {
+  if (millis() - _heartbeatTime >= _powerProfiles[_powerTier].heartbeatInterval) {
     sendHeartbeat();
     _heartbeatTime = millis();
   }
@@ -277,7 +360,7 @@ inline void manageBatteryLevel() {
   static unsigned long lastCheck = 0;
   static int lastBatteryPercent = 255;
 
-  if (millis() - lastCheck > 10000UL) {
+  if (millis() - lastCheck > _powerProfiles[_powerTier].batteryCheckInterval) {
     lastCheck = millis();
     battery.compute();
 
@@ -290,6 +373,7 @@ inline void manageBatteryLevel() {
       lastBatteryPercent = battery.getPercent();
     }
 
+    updatePowerTier();
     sleepIfBatteryToLow(true);
   }
 }
@@ -297,18 +381,27 @@ inline void manageBatteryLevel() {
 void sleepIfBatteryToLow(bool sendMsg) {
   battery.compute();
 
-  if (battery.getVoltage() <= 3.5) {
+  if (digitalRead(POWER_PROBE_PIN) == LOW && battery.getRawMillivolts() <= POWER_SLEEP_VOLTAGE * 1000) {
     if (sendMsg) {
       send(msgSirenLegacy.set("battery too low: sleep"));
       wait(500);
     }
 
+    stopSiren();
     transportDisable();
 
+    // the power probe interrupt wakes the MCU, hwSleep() then sleeps the rest of the step
+    unsigned long sleepTime = 0;
+
     do {
-      hwSleep(60000);
-      battery.compute();
-    } while (battery.getVoltage() <= 3.6);
+      hwSleep(POWER_SLEEP_STEP);
+      sleepTime += POWER_SLEEP_STEP;
+
+      if (sleepTime >= POWER_SLEEP_BATTERY_CHECK) {
+        sleepTime = 0;
+        battery.compute();
+      }
+    } while (digitalRead(POWER_PROBE_PIN) == LOW && battery.getRawMillivolts() <= POWER_WAKEUP_VOLTAGE * 1000);
 
     transportReInitialise();
 
@@ -319,67 +412,99 @@ void sleepIfBatteryToLow(bool sendMsg) {
 }
 
 void relayMessage(const MyMessage *message) {
-  if (getPayload(message->getString()) != NULL) {
-    msgToRelay.destination = getMessagePart(message->getString(), 0);
-    msgToRelay.sensor = getMessagePart(message->getString(), 1);
-    mSetCommand(msgToRelay, getMessagePart(message->getString(), 2));
-    mSetRequestAck(msgToRelay, getMessagePart(message->getString(), 3));
-    msgToRelay.type = getMessagePart(message->getString(), 4);
-    msgToRelay.sender = message->sender;
-    mSetAck(msgToRelay, false);
-    msgToRelay.set(getPayload(message->getString()));
-
-    relayTimer = millis();
-    bool success = false;
-    while (millis() - relayTimer < 2500 && !success) {
-      success = transportSendWrite(msgToRelay.destination, msgToRelay);
-      wait(5);
-    }
+  RelayHeader header;
+  const char *request = message->getString();
+  uint16_t checksum = relayChecksum(request);
+  RelayEntry *free = NULL;
 
-    if (success) {
-      send(msgRelayLegacy.set(F("success")));
-      send(msgRelay.set(F("success")));
-    } else {
-      send(msgRelayLegacy.set(F("ko")));
-      send(msgRelay.set(F("ko")));
-    }
+  if (!parseRelayHeader(request, &header)) {
+    return;
   }
-}
-
-int getMessagePart(const char *message, const byte index) {
-  byte indexCount = 0;
 
-  if (index == 0 && strlen(message) > 0) {
-    return atoi(message);
+  if (!_powerProfiles[_powerTier].relay) {
+    sendRelayResult(false, header.destination, header.sensor);
+    return;
   }
 
-  for (byte i = 0; i < strlen(message) - 1; i++) {
-    if (message[i] == '-') {
-      indexCount++;
-    }
+  for (byte i = 0; i < RELAY_QUEUE_SIZE; i++) {
+    RelayEntry *entry = &_relayQueue[i];
 
-    if (indexCount == index) {
-      return atoi(message + i + 1);
+    if (entry->state == RELAY_FREE) {
+      if (free == NULL) {
+        free = entry;
+      }
+    } else if (entry->requester == message->sender && entry->checksum == checksum) {
+      // the controller repeats a request it got no answer for
+      if (entry->state == RELAY_SUCCESS) {
+        sendRelayResult(true, header.destination, header.sensor);
+      }
+      return;
     }
   }
 
-  return 0;
-}
+  if (free == NULL) {
+    sendRelayResult(false, header.destination, header.sensor);
+    return;
+  }
 
-const char *getPayload(const char *message) {
-  byte indexCount = 0;
+  free->message.destination = header.destination;
+  free->message.sensor = header.sensor;
+  mSetCommand(free->message, header.command);
+  mSetRequestAck(free->message, header.requestAck);
+  free->message.type = header.type;
+  free->message.sender = message->sender;
+  mSetAck(free->message, false);
+  free->message.set(header.payload);
+
+  free->requester = message->sender;
+  free->checksum = checksum;
+  free->state = RELAY_PENDING;
+  free->startTime = millis();
+  free->tryTime = free->startTime - RELAY_RETRY_INTERVAL;
+}
 
-  for (byte i = 0; i < strlen(message) - 1; i++) {
-    if (message[i] == '-') {
-      indexCount++;
+// One write attempt per pending relay and per loop, so siren commands are handled in between
+inline void manageRelays() {
+  for (byte i = 0; i < RELAY_QUEUE_SIZE; i++) {
+    RelayEntry *entry = &_relayQueue[i];
+
+    if (entry->state == RELAY_PENDING) {
+      if (millis() - entry->tryTime >= RELAY_RETRY_INTERVAL) {
+        entry->tryTime = millis();
+
+        if (transportSendWrite(entry->message.destination, entry->message)) {
+          entry->state = RELAY_SUCCESS;
+          sendRelayResult(true, entry->message.destination, entry->message.sensor);
+        } else if (millis() - entry->startTime >= RELAY_TIMEOUT) {
+          // not kept: the same request again is a new attempt
+          entry->state = RELAY_FREE;
+          sendRelayResult(false, entry->message.destination, entry->message.sensor);
+        }
+      }
+    } else if (entry->state != RELAY_FREE && millis() - entry->startTime >= RELAY_DUPLICATE_WINDOW) {
+      entry->state = RELAY_FREE;
     }
+  }
+}
 
-    if (indexCount == 5) {
-      return message + i + 1;
-    }
+// The legacy child keeps its plain "success" / "ko", the new one says which
+// request the result is for: "success-destination-sensor" or "ko-destination-sensor"
+void sendRelayResult(bool success, byte destination, byte sensor) {
+  char result[RELAY_MAX_MESSAGE_SIZE + 1];
+
+  snprintf_P(result, sizeof(result), success ? PSTR("success-%u-%u") : PSTR("ko-%u-%u"), destination, sensor);
+  send(msgRelayLegacy.set(success ? F("success") : F("ko")));
+  send(msgRelay.set(result));
+}
+
+uint16_t relayChecksum(const char *request) {
+  uint16_t checksum = 0;
+
+  while (*request != '\0') {
+    checksum = (checksum << 1 | checksum >> 15) ^ (byte)*request++;
   }
 
-  return NULL;
+  return checksum;
 }
 
 void saveSirenDuration(unsigned long value) {
@@ -5,6 +5,7 @@
 #define REPORT_BATTERY_LEVEL
 
 #include <MySensors.h>
+#include <ChangeReporter.h>
 
 #define SOIL_ID 0
 #define SOIL_PIN A0
@@ -13,8 +14,13 @@
 #define AD_MAX  500 // Max Analog Value
 #define AD_MIN  0    // Min Analog Value
 
+#define EEPROM_SOIL_REPORT EEPROM_LOCAL_CONFIG_ADDRESS + 0
+
 MyMessage msg(SOIL_ID, V_LEVEL);
 
+// dead-band, relative band, hysteresis, rate per hour, heartbeat in minutes
+ChangeReporter soilReporter({2, REPORT_OFF, REPORT_OFF, 10, 720});
+
 #ifdef REPORT_BATTERY_LEVEL
 #include <Vcc.h>
 static uint8_t oldBatteryPcnt = 200;  // Initialize to 200 to assure first time value will be sent.
@@ -30,6 +36,14 @@ void setup()
   pinMode(SOIL_POWER, OUTPUT);
 
   digitalWrite(SOIL_POWER, LOW);
+  soilReporter.begin(EEPROM_SOIL_REPORT);
+}
+
+void receive(const MyMessage &message)
+{
+  if (message.sensor == SOIL_ID && message.type == V_CUSTOM) {
+    soilReporter.configure(message.getString());
+  }
 }
 
 void presentation()
@@ -51,7 +65,9 @@ void loop()
   Serial.println("%");
 #endif
   
-  send(msg.set(soilPercent));
+  if (soilReporter.update(soilPercent, 60) && send(msg.set(soilPercent))) {
+    soilReporter.markReported();
+  }
 
 #ifdef REPORT_BATTERY_LEVEL
   const uint8_t batteryPcnt = static_cast<uint8_t>(0.5 + vcc.Read_Perc(VccMin, VccMax));
@@ -71,6 +87,10 @@ void loop()
   }
 #endif
 
+  // listen a moment so a report configuration sent by the controller gets in
+  RF24_startListening();
+  wait(15);
+
 #ifdef MY_DEBUG
   delay(10000);
 #else
@@ -4,6 +4,7 @@
 #include <EEPROM.h>
 #include "BatteryLevel.h"
 #include <SoftwareSerial.h>
+#include <BleCommand.h>
 #include <MySensors.h>
 
 #define BLE_RX_PIN 5
@@ -20,6 +21,7 @@
 
 SoftwareSerial ble(BLE_TX_PIN, BLE_RX_PIN); // RX, TX
 BatteryLevel battery(BATTERY_LEVEL_PIN, EEPROM_VOLTAGE_CORRECTION);
+BleCommand bleCommand(ble);
 
 byte _linked = false;
 int8_t _wakeupReason = 100;
@@ -31,6 +33,9 @@ unsigned long _pumpDuration = 0;
 unsigned long _waitTimeMinute = 0;
 unsigned long _remainingTimeMinute = 0;
 
+byte _frequency;
+byte _amountOfWater;
+
 void setup() {
   Serial.begin(9600);
   ble.begin(9600);
@@ -45,9 +50,19 @@ void setup() {
   battery.init();
   battery.compute();
 
+  bleCommand.addCommand(F("start"), onStartCommand);
+  bleCommand.addCommand(F("stop"), onStopCommand);
+  bleCommand.addCommand(F("restart"), onRestartCommand);
+  bleCommand.addCommand(F("try"), onTryCommand);
+  bleCommand.addCommand(F("name"), onNameCommand);
+  bleCommand.addByte(F("frequency"), &_frequency, EEPROM_FREQUENCY, 1, 254, 3, onFrequencyChanged);
+  bleCommand.addByte(F("water"), &_amountOfWater, EEPROM_AMOUNT_OF_WATER, 0, 254, 50);
+  bleCommand.onData(sendBatteryToBleDevice);
+  bleCommand.load();
+
   Serial.println("Battery level: " + String(battery.getVoltage()) + "v (" + battery.getPercent() + "%)");
-  Serial.println("Frequency: " + String(getFrequency()) + " day(s)");
-  Serial.println("Amount of water: " + String(getAmountOfWater()) + " ml");
+  Serial.println("Frequency: " + String(_frequency) + " day(s)");
+  Serial.println("Amount of water: " + String(_amountOfWater) + " ml");
 
   startTimer();
   sleepBleDevice();
@@ -55,55 +70,11 @@ void setup() {
 
 void loop() {
   if (_wakeupReason != MY_WAKE_UP_BY_TIMER) {
-    while (ble.available()) {
-      String msg = ble.readStringUntil('\n');
-      Serial.println("ble: " + msg);
-  
-      if (msg == "cmd+start") {
-        startPump(100);
-      } else if (msg == "cmd+stop") {
-        stopPump();
-      } else if (msg == "cmd+data?") {
-        battery.compute();
-        Serial.println("Battery level: " + String(battery.getVoltage()) + "v (" + battery.getPercent() + "%)");
-        ble.println("batvol:" + String(battery.getVoltage()));
-        ble.println("batperc:" + String(battery.getPercent()));
-        ble.println("frequency:" + String(getFrequency()));
-        ble.println("water:" + String(getAmountOfWater()));
-        ble.println("time:" + String(_remainingTimeMinute));
-      } else if (msg.startsWith("cmd+frequency=")) {
-        byte frequency = parseCommand(msg, '=', 1).toInt();
-        saveFrequency(frequency);
-        Serial.println("Frequency: " + String(frequency));
-        ble.println("frequency:" + String(frequency));
-        startTimer();
-        ble.println("time:" + String(_remainingTimeMinute));
-      } else if (msg.startsWith("cmd+restart")) {
-        startTimer();
-        ble.println("time:" + String(_remainingTimeMinute));
-      } else if (msg.startsWith("cmd+water=")) {
-        byte water = parseCommand(msg, '=', 1).toInt();
-        saveAmountOfWater(water);
-        Serial.println("Amount of water: " + String(water));
-        ble.println("water:" + String(water));
-      } else if (msg.startsWith("cmd+name=")) {
-        String name = parseCommand(msg, '=', 1);
-        Serial.println("Name: " + String(name));
-        ble.print("+++");
-        delay(500);
-        ble.print("AT+NAME=[owb] " + name);
-        delay(500);
-        ble.print("AT+EXIT");
-      } else if (msg == "cmd+try") {
-        if (_pumpIsOn == false) {
-          byte water = getAmountOfWater();
-          startPump(water);
-        } else {
-          stopPump();
-        }
-      }
+    if (bleCommand.process()) {
+      Serial.print(F("ble: "));
+      Serial.println(bleCommand.getLine());
     }
-  
+
     if (Serial.available() > 0) {
       char incomingByte = Serial.read();
       ble.write(incomingByte);
@@ -128,8 +99,7 @@ void loop() {
       if (_remainingTimeMinute == 0) {
         Serial.println("It's time to water");
         _remainingTimeMinute = _waitTimeMinute;
-        byte water = getAmountOfWater();
-        startPump(water);
+        startPump(_amountOfWater);
         _wakeupReason = 100;
       }
     }
@@ -141,7 +111,7 @@ void loop() {
 }
 
 void startTimer() {
-  _waitTimeMinute = getFrequency() * 24 * 60;
+  _waitTimeMinute = _frequency * 24UL * 60;
   _remainingTimeMinute = _waitTimeMinute;
 }
 
@@ -183,47 +153,47 @@ inline void manageBleDevice() {
   }
 }
 
-byte getFrequency() {
-  byte result = EEPROM.read(EEPROM_FREQUENCY);
-
-  if (result == 255) {
-    result = 3;
-  }
-
-  return result;
+void sendBatteryToBleDevice() {
+  battery.compute();
+  Serial.println("Battery level: " + String(battery.getVoltage()) + "v (" + battery.getPercent() + "%)");
+  ble.println("batvol:" + String(battery.getVoltage()));
+  ble.println("batperc:" + String(battery.getPercent()));
+  ble.println("time:" + String(_remainingTimeMinute));
 }
 
-byte getAmountOfWater() {
-  byte result = EEPROM.read(EEPROM_AMOUNT_OF_WATER);
-
-  if (result == 255) {
-    result = 50;
-  }
-
-  return result;
+void onStartCommand(const char *value) {
+  startPump(100);
 }
 
-void saveFrequency(byte value) {
-  EEPROM.update(EEPROM_FREQUENCY, value);
+void onStopCommand(const char *value) {
+  stopPump();
 }
 
-void saveAmountOfWater(byte value) {
-  EEPROM.update(EEPROM_AMOUNT_OF_WATER, value);
+void onRestartCommand(const char *value) {
+  startTimer();
+  ble.println("time:" + String(_remainingTimeMinute));
 }
 
-String parseCommand(String data, char separator, int index)
-{
-  int found = 0;
-  int strIndex[] = {0, -1};
-  int maxIndex = data.length() - 1;
-
-  for (int i = 0; i <= maxIndex && found <= index; i++) {
-    if (data.charAt(i) == separator || i == maxIndex || data.charAt(i) == '\n' || data.charAt(i) == '\r') {
-      found++;
-      strIndex[0] = strIndex[1] + 1;
-      strIndex[1] = (i == maxIndex) ? i + 1 : i;
-    }
+void onTryCommand(const char *value) {
+  if (_pumpIsOn == false) {
+    startPump(_amountOfWater);
+  } else {
+    stopPump();
   }
+}
+
+void onFrequencyChanged(const char *value) {
+  startTimer();
+  ble.println("time:" + String(_remainingTimeMinute));
+}
 
-  return found > index ? data.substring(strIndex[0], strIndex[1]) : "";
+void onNameCommand(const char *name) {
+  Serial.print(F("Name: "));
+  Serial.println(name);
+  ble.print("+++");
+  delay(500);
+  ble.print(F("AT+NAME=[owb] "));
+  ble.print(name);
+  delay(500);
+  ble.print("AT+EXIT");
 }
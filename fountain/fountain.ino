@@ -19,6 +19,7 @@
 #include <SPI.h>
 #include <OneWire.h>
 #include <DallasTemperature.h>
+#include <TemperatureFormat.h>
 
 #define PIN_WATER_SENSOR1 A1
 #define PIN_WATER_PUMP1 7
@@ -30,6 +31,10 @@
 #define PIN_TEMPERATURE 5
 
 #define TEMPERATURE_PRECISION 11 //Max 12 bit, min 9 bit
+#define DALLAS_MAX_SENSORS 4
+
+// Define EEPROM addresses
+#define EEPROM_DALLAS_DEVICES EEPROM_LOCAL_CONFIG_ADDRESS + 0 // DEVICE_TABLE_EEPROM_SIZE(DALLAS_MAX_SENSORS) bytes storage
 
 #define TEMPERATURE_ID 0
 #define PUMP1_ID 1
@@ -48,7 +53,7 @@ unsigned long _heartbeatTime = 0;
 // Temperature sensor
 OneWire oneWire(PIN_TEMPERATURE);
 DallasTemperature sensors(&oneWire);
-byte dallasSensorAddress[8];
+DeviceAddress dallasSensors[DALLAS_MAX_SENSORS];
 
 // Status
 bool lightOn;
@@ -148,9 +153,11 @@ void receive(const MyMessage &message)
 void loop() {
   if ((millis() - lastSendTemperatureTime) >= 600000) {
     lastSendTemperatureTime = millis();
+    requestDallasTemperature();
+  }
 
-    float temp = getDallasTemperature();
-    send(msgTemperature.set(temp, 1));
+  if (sensors.processConversion()) {
+    powerOffDallasSensor();
   }
 
   if (lightOn || light2On || pump1On || pump2On) {
@@ -296,36 +303,34 @@ void initializeDallasSensor() {
   // Allow 50ms for the sensor to be ready
   delay(50);
 
-  sensors.begin();
+  // Probe addresses are restored from EEPROM, the bus is only searched if they do not answer
+  sensors.begin(EEPROM_DALLAS_DEVICES, dallasSensors, DALLAS_MAX_SENSORS);
   sensors.setWaitForConversion(false);
-  int numSensors = sensors.getDeviceCount();
-  oneWire.search(dallasSensorAddress);
-  sensors.setResolution(dallasSensorAddress, TEMPERATURE_PRECISION);
+  sensors.setResolution(TEMPERATURE_PRECISION);
 
   // set power pin for DS18B20 to input before sleeping, saves power
   digitalWrite(PIN_ALIM_TEMPERATURE, LOW);
   pinMode(PIN_ALIM_TEMPERATURE, INPUT);
 }
 
-float getDallasTemperature() {
+void requestDallasTemperature() {
   pinMode(PIN_ALIM_TEMPERATURE, OUTPUT);
   digitalWrite(PIN_ALIM_TEMPERATURE, HIGH);
-  sleep(30);
-
-  sensors.setResolution(dallasSensorAddress, TEMPERATURE_PRECISION);
-  sensors.requestTemperatures(); // Send the command to get temperatures
+  wait(30); // repeater cannot sleep
 
-  // 9bit requres 95ms, 10bit 187ms, 11bit 375ms and 12bit resolution takes 750ms
-  sleep(400);
+  sensors.setResolution(TEMPERATURE_PRECISION);
+  sensors.requestTemperaturesAsync(onDallasTemperature); // Start conversion, result is delivered from loop()
+}
 
-  // Fetch temperature
-  float temperature = sensors.getTempC(dallasSensorAddress);
+void onDallasTemperature(const uint8_t* deviceAddress, int16_t raw) {
+  char buffer[TEMPERATURE_FORMAT_SIZE];
+  send(msgTemperature.set(formatTemperature(DallasTemperature::rawToCentiCelsius(raw), buffer)));
+}
 
+void powerOffDallasSensor() {
   // set power pin for DS18B20 to input before sleeping, saves power
   digitalWrite(PIN_ALIM_TEMPERATURE, LOW);
   pinMode(PIN_ALIM_TEMPERATURE, INPUT);
-
-  return temperature;
 }
 
 String parseMsg(String data, char separator, int index)